@@ -0,0 +1,278 @@
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/pipeline.comp.h"
+#include "shaders/fullscreen.vert.h"
+#include "shaders/pipeline.frag.h"
+
+static const uint32_t framebufferSize = 2048;
+static const uint32_t drawCount = 4;
+static const int32_t fragmentIterations = 64;
+static const uint32_t localSize = 128; // Minimal guaranteed maxComputeWorkGroupSize[0]
+static const uint32_t elementCount = 1024 * 1024;
+static const int32_t computeIterations = 256;
+static const uint32_t repeatCount = 20;
+
+// Command buffers submitted to one queue, completion is signaled by fence
+struct Submission
+{
+    VkQueue queue;
+    std::vector<VkCommandBuffer> commandBuffers;
+    VkFence fence;
+};
+
+// Submits all at once and polls fences, returns completion time of every submission
+// since the first vkQueueSubmit in milliseconds.
+// Timestamps of different queues may be not comparable, so CPU clock is used instead.
+static std::vector<double> submitAndPoll(const DeviceContext& context, const std::vector<Submission>& submissions)
+{
+    std::vector<double> completionTimes(submissions.size(), 0.);
+    std::vector<bool> completed(submissions.size(), false);
+    const auto begin = Clock::now();
+    for (const auto& submission : submissions)
+    {
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(submission.commandBuffers.size());
+        submitInfo.pCommandBuffers = submission.commandBuffers.data();
+        checkResult(vkQueueSubmit(submission.queue, 1, &submitInfo, submission.fence), "vkQueueSubmit");
+    }
+    std::size_t completedCount = 0;
+    while (completedCount < submissions.size())
+    {
+        for (std::size_t i = 0; i < submissions.size(); ++i)
+        {
+            if (completed[i])
+                continue;
+            const VkResult result = vkGetFenceStatus(context.getDevice(), submissions[i].fence);
+            checkResult(result, "vkGetFenceStatus");
+            if (VK_SUCCESS == result)
+            {
+                completionTimes[i] = elapsedMilliseconds(begin, Clock::now());
+                completed[i] = true;
+                ++completedCount;
+            }
+        }
+    }
+    for (const auto& submission : submissions)
+        checkResult(vkResetFences(context.getDevice(), 1, &submission.fence), "vkResetFences");
+    return completionTimes;
+}
+
+struct OverlapResult
+{
+    Timing graphicsAlone;
+    Timing computeAlone;
+    Timing serial; // Both workloads on graphics queue
+    Timing concurrent; // Until both are complete
+    Timing concurrentGraphics;
+    Timing concurrentCompute;
+};
+
+// Fixed fragment-bound graphics workload and ALU-bound compute workload
+class OverlapScene
+{
+public:
+    OverlapScene(const DeviceContext& context, uint32_t graphicsFamilyIndex);
+    OverlapResult run(uint32_t computeFamilyIndex);
+
+private:
+    void recordGraphics(VkCommandBuffer commandBuffer) const;
+    void recordCompute(VkCommandBuffer commandBuffer, bool afterGraphics) const;
+
+    const DeviceContext& context;
+    const VkQueue graphicsQueue;
+    RenderPass renderPass;
+    Image colorImage;
+    Framebuffer framebuffer;
+    ShaderModule computeShader;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    DescriptorSetLayout descriptorSetLayout;
+    PipelineLayout pipelineLayout;
+    Pipeline graphicsPipeline;
+    Pipeline computePipeline;
+    Buffer storageBuffer;
+    DescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    CommandPool graphicsCommandPool;
+    VkCommandBuffer graphicsCommandBuffer;
+    VkCommandBuffer serialComputeCommandBuffer;
+    Fence graphicsFence;
+    Fence computeFence;
+};
+
+OverlapScene::OverlapScene(const DeviceContext& context, uint32_t graphicsFamilyIndex):
+    context(context),
+    graphicsQueue(context.getQueue(graphicsFamilyIndex)),
+    renderPass(context.createRenderPass(VK_FORMAT_R8G8B8A8_UNORM)),
+    colorImage(context.createImage(VK_FORMAT_R8G8B8A8_UNORM, framebufferSize, framebufferSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)),
+    framebuffer(context.createFramebuffer(renderPass, {colorImage.view}, framebufferSize, framebufferSize)),
+    computeShader(context.createShaderModule(pipeline_comp, sizeof(pipeline_comp))),
+    vertexShader(context.createShaderModule(fullscreen_vert, sizeof(fullscreen_vert))),
+    fragmentShader(context.createShaderModule(pipeline_frag, sizeof(pipeline_frag))),
+    storageBuffer(context.createBuffer(elementCount * sizeof(float) * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)),
+    graphicsCommandPool(context.createCommandPool(graphicsFamilyIndex)),
+    graphicsFence(context.createFence()),
+    computeFence(context.createFence())
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    descriptorSetLayout = context.createDescriptorSetLayout({binding});
+    pipelineLayout = context.createPipelineLayout({descriptorSetLayout});
+    const VkSpecializationMapEntry fragmentEntry = {0, 0, sizeof(int32_t)};
+    VkSpecializationInfo fragmentSpecialization;
+    fragmentSpecialization.mapEntryCount = 1;
+    fragmentSpecialization.pMapEntries = &fragmentEntry;
+    fragmentSpecialization.dataSize = sizeof(int32_t);
+    fragmentSpecialization.pData = &fragmentIterations;
+    graphicsPipeline = context.createGraphicsPipeline(vertexShader, fragmentShader, &fragmentSpecialization, pipelineLayout, renderPass);
+    const struct
+    {
+        uint32_t localSize;
+        int32_t iterations;
+    } computeConstants = {localSize, computeIterations};
+    const VkSpecializationMapEntry computeEntries[] = {
+        {0, 0, sizeof(uint32_t)},
+        {1, sizeof(uint32_t), sizeof(int32_t)}
+    };
+    VkSpecializationInfo computeSpecialization;
+    computeSpecialization.mapEntryCount = 2;
+    computeSpecialization.pMapEntries = computeEntries;
+    computeSpecialization.dataSize = sizeof(computeConstants);
+    computeSpecialization.pData = &computeConstants;
+    computePipeline = context.createComputePipeline(computeShader, &computeSpecialization, pipelineLayout);
+    descriptorPool = context.createDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+    descriptorSet = context.allocateDescriptorSet(descriptorPool, descriptorSetLayout);
+    VkDescriptorBufferInfo bufferInfo = {storageBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+    graphicsCommandBuffer = context.allocateCommandBuffer(graphicsCommandPool);
+    recordGraphics(graphicsCommandBuffer);
+    serialComputeCommandBuffer = context.allocateCommandBuffer(graphicsCommandPool);
+    recordCompute(serialComputeCommandBuffer, true);
+}
+
+void OverlapScene::recordGraphics(VkCommandBuffer commandBuffer) const
+{
+    const VkClearValue clearValue = {};
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea = {{0, 0}, {framebufferSize, framebufferSize}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    const VkViewport viewport = {0.f, 0.f, float(framebufferSize), float(framebufferSize), 0.f, 1.f};
+    const VkRect2D scissor = {{0, 0}, {framebufferSize, framebufferSize}};
+    beginCommandBuffer(commandBuffer);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    for (uint32_t i = 0; i < drawCount; ++i)
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    vkCmdEndRenderPass(commandBuffer);
+    endCommandBuffer(commandBuffer);
+}
+
+void OverlapScene::recordCompute(VkCommandBuffer commandBuffer, bool afterGraphics) const
+{
+    beginCommandBuffer(commandBuffer);
+    if (afterGraphics)
+    {   // Command buffers of one batch may overlap, so serial baseline waits for graphics explicitly
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+            0, nullptr, 0, nullptr, 0, nullptr);
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdDispatch(commandBuffer, elementCount / localSize, 1, 1);
+    endCommandBuffer(commandBuffer);
+}
+
+OverlapResult OverlapScene::run(uint32_t computeFamilyIndex)
+{   // Contents of storage buffer are of no interest, so its ownership isn't transferred between families
+    const VkQueue computeQueue = context.getQueue(computeFamilyIndex);
+    CommandPool computeCommandPool = context.createCommandPool(computeFamilyIndex);
+    const VkCommandBuffer computeCommandBuffer = context.allocateCommandBuffer(computeCommandPool);
+    recordCompute(computeCommandBuffer, false);
+    const Submission graphics = {graphicsQueue, {graphicsCommandBuffer}, graphicsFence};
+    const Submission compute = {computeQueue, {computeCommandBuffer}, computeFence};
+    const Submission serial = {graphicsQueue, {graphicsCommandBuffer, serialComputeCommandBuffer}, graphicsFence};
+    OverlapResult result;
+    result.graphicsAlone = measureSamples(repeatCount,
+        [&]() { return submitAndPoll(context, {graphics})[0]; });
+    result.computeAlone = measureSamples(repeatCount,
+        [&]() { return submitAndPoll(context, {compute})[0]; });
+    result.serial = measureSamples(repeatCount,
+        [&]() { return submitAndPoll(context, {serial})[0]; });
+    // Completion times of each queue are filtered along with the total
+    const std::vector<Timing> concurrent = measurePaired(repeatCount,
+        [&]()
+        {
+            const std::vector<double> completionTimes = submitAndPoll(context, {graphics, compute});
+            return std::vector<double>{std::max(completionTimes[0], completionTimes[1]), completionTimes[0], completionTimes[1]};
+        });
+    result.concurrent = concurrent[0];
+    result.concurrentGraphics = concurrent[1];
+    result.concurrentCompute = concurrent[2];
+    return result;
+}
+
+void benchmarkAsyncCompute(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    DeviceContext context(physicalDevice->getHandle());
+    const uint32_t graphicsFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+    if (UINT32_MAX == graphicsFamilyIndex)
+        throw BenchmarkSkipped("no graphics queue family");
+    const std::vector<VkQueueFamilyProperties>& queueFamilies = context.getQueueFamilies();
+    std::vector<uint32_t> computeFamilyIndices;
+    for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilies.size(); ++queueFamilyIndex)
+    {
+        if ((queueFamilies[queueFamilyIndex].queueFlags & VK_QUEUE_COMPUTE_BIT) && (queueFamilyIndex != graphicsFamilyIndex))
+            computeFamilyIndices.push_back(queueFamilyIndex);
+    }
+    if (computeFamilyIndices.empty())
+        throw BenchmarkSkipped("no compute queue family besides graphics one");
+    OverlapScene scene(context, graphicsFamilyIndex);
+    setFieldWidth(30);
+    printEndLn();
+    std::cout << "Graphics: #" << graphicsFamilyIndex << " " << queueFlagsString(queueFamilies[graphicsFamilyIndex].queueFlags) << std::endl;
+    printLn("Framebuffer size", framebufferSize, framebufferSize);
+    printLn("Fullscreen draws", drawCount);
+    printLn("Fragment shader iterations", fragmentIterations);
+    printLn("Compute invocations", elementCount);
+    printLn("Compute shader iterations", computeIterations);
+    for (uint32_t computeFamilyIndex : computeFamilyIndices)
+    {
+        const OverlapResult result = scene.run(computeFamilyIndex);
+        const std::string path = "queue family=" + std::to_string(computeFamilyIndex) + "/";
+        recordResult(path + "graphics alone", result.graphicsAlone);
+        recordResult(path + "compute alone", result.computeAlone);
+        recordResult(path + "serial", result.serial);
+        recordResult(path + "concurrent", result.concurrent);
+        recordResult(path + "concurrent graphics", result.concurrentGraphics);
+        recordResult(path + "concurrent compute", result.concurrentCompute);
+        // 1 if shorter workload is completely hidden by longer one, 0 if queues are serialized
+        const double overlap = (result.serial.median - result.concurrent.median) /
+            std::min(result.graphicsAlone.median, result.computeAlone.median);
+        printEndLn();
+        std::cout << "Compute: #" << computeFamilyIndex << " " << queueFlagsString(queueFamilies[computeFamilyIndex].queueFlags) << std::endl;
+        printLn("Graphics alone, ms", fixedString(result.graphicsAlone.median, 3));
+        printLn("Compute alone, ms", fixedString(result.computeAlone.median, 3));
+        printLn("Serial on graphics queue, ms", fixedString(result.serial.median, 3));
+        printLn("Concurrent, ms", fixedString(result.concurrent.median, 3));
+        printLn("Overlap ratio", fixedString(overlap, 2));
+        printLn("Graphics slowdown", fixedString(result.concurrentGraphics.median / result.graphicsAlone.median, 2) + "x");
+        printLn("Compute slowdown", fixedString(result.concurrentCompute.median / result.computeAlone.median, 2) + "x");
+    }
+}
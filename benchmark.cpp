@@ -0,0 +1,920 @@
+#include <ctime>
+#include <unordered_map>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "results.h"
+
+static const Benchmark benchmarks[] = {
+    {"device-group", "Device Group Peer Transfer", benchmarkDeviceGroup},
+    {"pipelines", "Pipeline Creation Scaling", benchmarkPipelines},
+    {"command-buffers", "Command Buffer Recording", benchmarkCommandBuffers},
+    {"descriptors", "Descriptor Allocation and Update", benchmarkDescriptors},
+    {"subgroups", "Subgroup Reduction and Scan", benchmarkSubgroups},
+    {"calibration", "GPU/CPU Timestamp Calibration", benchmarkCalibration},
+    {"non-coherent", "Non-Coherent Memory Flush and Invalidate", benchmarkNonCoherentMemory},
+    {"textures", "Compressed Texture Upload and Sampling", benchmarkTextures},
+    {"sparse", "Sparse Binding Latency and Throughput", benchmarkSparseBinding},
+    {"async-compute", "Async Compute Overlap", benchmarkAsyncCompute},
+    {"indirect", "Indirect Draw and Dispatch Throughput", benchmarkIndirect},
+    {"msaa", "MSAA Render and Resolve Cost", benchmarkMsaa},
+    {"constants", "Per-Draw Constant Update Paths", benchmarkConstants},
+    {"sync", "Synchronization Primitive Latency", benchmarkSynchronization},
+};
+
+BenchmarkOptions benchmarkOptions;
+static std::vector<ResultRecord> benchmarkResults;
+
+DeviceContext::DeviceContext(VkPhysicalDevice physicalDevice, const DeviceOptions& options):
+    physicalDevice(physicalDevice)
+{
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    const float priority = 1.f;
+    std::vector<VkDeviceQueueCreateInfo> queueInfos;
+    for (uint32_t i = 0; i < queueFamilyCount; ++i)
+    {
+        VkDeviceQueueCreateInfo queueInfo = {};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = i;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+        queueInfos.push_back(queueInfo);
+    }
+    VkDeviceGroupDeviceCreateInfo deviceGroupInfo = {};
+    VkDeviceCreateInfo deviceInfo = {};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = options.extendedFeatures;
+    if (options.deviceGroup.size() > 1)
+    {
+        deviceGroupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO;
+        deviceGroupInfo.pNext = deviceInfo.pNext;
+        deviceGroupInfo.physicalDeviceCount = static_cast<uint32_t>(options.deviceGroup.size());
+        deviceGroupInfo.pPhysicalDevices = options.deviceGroup.data();
+        deviceInfo.pNext = &deviceGroupInfo;
+        deviceCount = deviceGroupInfo.physicalDeviceCount;
+    }
+    deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
+    deviceInfo.pQueueCreateInfos = queueInfos.data();
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(options.extensions.size());
+    deviceInfo.ppEnabledExtensionNames = options.extensions.data();
+    deviceInfo.pEnabledFeatures = &options.features;
+    checkResult(vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device), "vkCreateDevice");
+    for (uint32_t i = 0; i < queueFamilyCount; ++i)
+    {
+        VkQueue queue;
+        vkGetDeviceQueue(device, i, 0, &queue);
+        queues.push_back(queue);
+    }
+    for (const char *extensionName : options.extensions)
+        enabledExtensions.push_back(extensionName);
+}
+
+DeviceContext::~DeviceContext()
+{
+    if (device != VK_NULL_HANDLE)
+    {
+        vkDeviceWaitIdle(device);
+        vkDestroyDevice(device, nullptr);
+    }
+}
+
+bool DeviceContext::extensionEnabled(const char *extensionName) const noexcept
+{
+    return std::find(enabledExtensions.begin(), enabledExtensions.end(), extensionName) != enabledExtensions.end();
+}
+
+uint32_t DeviceContext::findQueueFamily(VkQueueFlags flags, VkQueueFlags excludedFlags) const noexcept
+{
+    uint32_t found = UINT32_MAX;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilies.size()); ++i)
+    {
+        VkQueueFlags queueFlags = queueFamilies[i].queueFlags;
+        // Graphics and compute queues implicitly support transfer operations
+        if (queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+            queueFlags |= VK_QUEUE_TRANSFER_BIT;
+        if ((queueFlags & flags) != flags || (queueFlags & excludedFlags))
+            continue;
+        if (queueFlags == flags)
+            return i;
+        if (UINT32_MAX == found)
+            found = i;
+    }
+    return found;
+}
+
+uint32_t DeviceContext::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags flags) const noexcept
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((memoryTypeBits & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+uint32_t DeviceContext::getBufferMemoryTypeBits(VkBufferUsageFlags usage) const
+{   // Same for every buffer created with the same usage and flags
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = 1;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer handle;
+    checkResult(vkCreateBuffer(device, &bufferInfo, nullptr, &handle), "vkCreateBuffer");
+    BufferHandle buffer(device, handle);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    return memoryRequirements.memoryTypeBits;
+}
+
+Buffer DeviceContext::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags) const
+{
+    return createBuffer(size, usage, memoryFlags, UINT32_MAX, nullptr);
+}
+
+Buffer DeviceContext::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryTypeIndex, const void *allocateNext) const
+{
+    return createBuffer(size, usage, 0, memoryTypeIndex, allocateNext);
+}
+
+Buffer DeviceContext::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags,
+    uint32_t memoryTypeIndex, const void *allocateNext) const
+{
+    Buffer buffer;
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer handle;
+    checkResult(vkCreateBuffer(device, &bufferInfo, nullptr, &handle), "vkCreateBuffer");
+    buffer.buffer = BufferHandle(device, handle);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, handle, &memoryRequirements);
+    if (UINT32_MAX == memoryTypeIndex)
+        memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, memoryFlags);
+    if (UINT32_MAX == memoryTypeIndex)
+        throw BenchmarkSkipped("no memory type with requested properties");
+    if (!(memoryRequirements.memoryTypeBits & (1u << memoryTypeIndex)))
+        throw BenchmarkSkipped("memory type " + std::to_string(memoryTypeIndex) + " is not allowed for buffer");
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = allocateNext;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    VkDeviceMemory memory;
+    checkResult(vkAllocateMemory(device, &allocInfo, nullptr, &memory), "vkAllocateMemory");
+    buffer.memory = DeviceMemory(device, memory);
+    checkResult(vkBindBufferMemory(device, handle, memory, 0), "vkBindBufferMemory");
+    buffer.size = size;
+    buffer.memoryTypeIndex = memoryTypeIndex;
+    const VkMemoryType& memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
+    const VkMemoryHeap& memoryHeap = memoryProperties.memoryHeaps[memoryType.heapIndex];
+    // Memory with multiple instances can't be mapped
+    const bool multiInstance = (deviceCount > 1) && (memoryHeap.flags & VK_MEMORY_HEAP_MULTI_INSTANCE_BIT);
+    if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !multiInstance)
+        checkResult(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &buffer.data), "vkMapMemory");
+    return buffer;
+}
+
+CommandPool DeviceContext::createCommandPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags) const
+{
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = flags;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    VkCommandPool commandPool;
+    checkResult(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool), "vkCreateCommandPool");
+    return CommandPool(device, commandPool);
+}
+
+VkCommandBuffer DeviceContext::allocateCommandBuffer(VkCommandPool commandPool, VkCommandBufferLevel level) const
+{
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = level;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer;
+    checkResult(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer), "vkAllocateCommandBuffers");
+    return commandBuffer;
+}
+
+Fence DeviceContext::createFence(bool signaled /* false */) const
+{
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = signaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
+    VkFence fence;
+    checkResult(vkCreateFence(device, &fenceInfo, nullptr, &fence), "vkCreateFence");
+    return Fence(device, fence);
+}
+
+Semaphore DeviceContext::createSemaphore(const void *next /* nullptr */) const
+{
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = next;
+    VkSemaphore semaphore;
+    checkResult(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore), "vkCreateSemaphore");
+    return Semaphore(device, semaphore);
+}
+
+Event DeviceContext::createEvent() const
+{
+    VkEventCreateInfo eventInfo = {};
+    eventInfo.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
+    VkEvent event;
+    checkResult(vkCreateEvent(device, &eventInfo, nullptr, &event), "vkCreateEvent");
+    return Event(device, event);
+}
+
+QueryPool DeviceContext::createQueryPool(VkQueryType queryType, uint32_t queryCount) const
+{
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = queryType;
+    queryPoolInfo.queryCount = queryCount;
+    VkQueryPool queryPool;
+    checkResult(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool), "vkCreateQueryPool");
+    return QueryPool(device, queryPool);
+}
+
+Image DeviceContext::createImage(VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage,
+    VkSampleCountFlagBits samples /* VK_SAMPLE_COUNT_1_BIT */, uint32_t mipLevels /* 1 */) const
+{
+    Image image;
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = {width, height, 1};
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = samples;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImage handle;
+    checkResult(vkCreateImage(device, &imageInfo, nullptr, &handle), "vkCreateImage");
+    image.image = ImageHandle(device, handle);
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device, handle, &memoryRequirements);
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (UINT32_MAX == allocInfo.memoryTypeIndex)
+        allocInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, 0);
+    VkDeviceMemory memory;
+    checkResult(vkAllocateMemory(device, &allocInfo, nullptr, &memory), "vkAllocateMemory");
+    image.memory = DeviceMemory(device, memory);
+    checkResult(vkBindImageMemory(device, handle, memory, 0), "vkBindImageMemory");
+    image.format = format;
+    image.extent = imageInfo.extent;
+    image.mipLevels = mipLevels;
+    const VkImageUsageFlags viewUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    if (usage & viewUsage)
+    {
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = handle;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+        VkImageView view;
+        checkResult(vkCreateImageView(device, &viewInfo, nullptr, &view), "vkCreateImageView");
+        image.view = ImageView(device, view);
+    }
+    return image;
+}
+
+Framebuffer DeviceContext::createFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& attachments,
+    uint32_t width, uint32_t height) const
+{
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = width;
+    framebufferInfo.height = height;
+    framebufferInfo.layers = 1;
+    VkFramebuffer framebuffer;
+    checkResult(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer), "vkCreateFramebuffer");
+    return Framebuffer(device, framebuffer);
+}
+
+ShaderModule DeviceContext::createShaderModule(const uint32_t *code, std::size_t size) const
+{
+    VkShaderModuleCreateInfo shaderModuleInfo = {};
+    shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleInfo.codeSize = size;
+    shaderModuleInfo.pCode = code;
+    VkShaderModule shaderModule;
+    checkResult(vkCreateShaderModule(device, &shaderModuleInfo, nullptr, &shaderModule), "vkCreateShaderModule");
+    return ShaderModule(device, shaderModule);
+}
+
+Sampler DeviceContext::createSampler(VkFilter filter, VkSamplerAddressMode addressMode) const
+{
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = filter;
+    samplerInfo.minFilter = filter;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = addressMode;
+    samplerInfo.addressModeV = addressMode;
+    samplerInfo.addressModeW = addressMode;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VkSampler sampler;
+    checkResult(vkCreateSampler(device, &samplerInfo, nullptr, &sampler), "vkCreateSampler");
+    return Sampler(device, sampler);
+}
+
+DescriptorSetLayout DeviceContext::createDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    VkDescriptorSetLayoutCreateFlags flags /* 0 */, const void *next /* nullptr */) const
+{
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.pNext = next;
+    setLayoutInfo.flags = flags;
+    setLayoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    setLayoutInfo.pBindings = bindings.data();
+    VkDescriptorSetLayout setLayout;
+    checkResult(vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout), "vkCreateDescriptorSetLayout");
+    return DescriptorSetLayout(device, setLayout);
+}
+
+PipelineLayout DeviceContext::createPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts,
+    const std::vector<VkPushConstantRange>& pushConstantRanges /* {} */) const
+{
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+    VkPipelineLayout pipelineLayout;
+    checkResult(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout), "vkCreatePipelineLayout");
+    return PipelineLayout(device, pipelineLayout);
+}
+
+DescriptorPool DeviceContext::createDescriptorPool(uint32_t maxSets, const std::vector<VkDescriptorPoolSize>& poolSizes,
+    VkDescriptorPoolCreateFlags flags /* 0 */, const void *next /* nullptr */) const
+{
+    VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
+    descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.pNext = next;
+    descriptorPoolInfo.flags = flags;
+    descriptorPoolInfo.maxSets = maxSets;
+    descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    descriptorPoolInfo.pPoolSizes = poolSizes.data();
+    VkDescriptorPool descriptorPool;
+    checkResult(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool), "vkCreateDescriptorPool");
+    return DescriptorPool(device, descriptorPool);
+}
+
+VkDescriptorSet DeviceContext::allocateDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout setLayout,
+    const void *next /* nullptr */) const
+{
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = next;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+    VkDescriptorSet descriptorSet;
+    checkResult(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet), "vkAllocateDescriptorSets");
+    return descriptorSet;
+}
+
+Pipeline DeviceContext::createComputePipeline(VkShaderModule shader, const VkSpecializationInfo *specialization,
+    VkPipelineLayout layout, VkPipelineCache pipelineCache /* VK_NULL_HANDLE */) const
+{
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = specialization;
+    pipelineInfo.layout = layout;
+    VkPipeline pipeline;
+    checkResult(vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline), "vkCreateComputePipelines");
+    return Pipeline(device, pipeline);
+}
+
+RenderPass DeviceContext::createRenderPass(VkFormat colorFormat, VkSampleCountFlagBits samples /* VK_SAMPLE_COUNT_1_BIT */) const
+{
+    VkAttachmentDescription attachment = {};
+    attachment.format = colorFormat;
+    attachment.samples = samples;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference colorAttachment = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachment;
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &attachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    VkRenderPass renderPass;
+    checkResult(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass), "vkCreateRenderPass");
+    return RenderPass(device, renderPass);
+}
+
+Pipeline DeviceContext::createGraphicsPipeline(VkShaderModule vertexShader, VkShaderModule fragmentShader,
+    const VkSpecializationInfo *fragmentSpecialization, VkPipelineLayout layout, VkRenderPass renderPass,
+    VkSampleCountFlagBits samples /* VK_SAMPLE_COUNT_1_BIT */, VkPipelineCache pipelineCache /* VK_NULL_HANDLE */) const
+{
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertexShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragmentShader;
+    stages[1].pName = "main";
+    stages[1].pSpecializationInfo = fragmentSpecialization;
+    VkPipelineVertexInputStateCreateInfo vertexInputState = {};
+    vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
+    inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo rasterizationState = {};
+    rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizationState.cullMode = VK_CULL_MODE_NONE;
+    rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizationState.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisampleState = {};
+    multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleState.rasterizationSamples = samples;
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colorBlendState = {};
+    colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendState.attachmentCount = 1;
+    colorBlendState.pAttachments = &blendAttachment;
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInputState;
+    pipelineInfo.pInputAssemblyState = &inputAssemblyState;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizationState;
+    pipelineInfo.pMultisampleState = &multisampleState;
+    pipelineInfo.pColorBlendState = &colorBlendState;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    VkPipeline pipeline;
+    checkResult(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline), "vkCreateGraphicsPipelines");
+    return Pipeline(device, pipeline);
+}
+
+void DeviceContext::submit(VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence, const void *next /* nullptr */) const
+{
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = next;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    checkResult(vkQueueSubmit(queue, 1, &submitInfo, fence), "vkQueueSubmit");
+}
+
+void DeviceContext::waitAndReset(VkFence fence) const
+{
+    checkResult(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+    checkResult(vkResetFences(device, 1, &fence), "vkResetFences");
+}
+
+double DeviceContext::submitAndWait(VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence, const void *next /* nullptr */) const
+{
+    const auto begin = Clock::now();
+    submit(queue, commandBuffer, fence, next);
+    checkResult(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+    const auto end = Clock::now();
+    checkResult(vkResetFences(device, 1, &fence), "vkResetFences");
+    return elapsedMilliseconds(begin, end);
+}
+
+double DeviceContext::timestampDelta(uint64_t begin, uint64_t end) const noexcept
+{
+    return (end - begin) * static_cast<double>(properties.limits.timestampPeriod) / 1e6;
+}
+
+bool deviceExtensionSupported(VkPhysicalDevice physicalDevice, const char *extensionName)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+    for (const auto& extension : extensions)
+    {
+        if (!strcmp(extension.extensionName, extensionName))
+            return true;
+    }
+    return false;
+}
+
+uint32_t enumerateInstanceVersion()
+{
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+        vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+    if (enumerateInstanceVersion)
+        enumerateInstanceVersion(&apiVersion);
+    // Patch version of the loader doesn't matter to application
+    return VK_MAKE_VERSION(VK_VERSION_MAJOR(apiVersion), VK_VERSION_MINOR(apiVersion), 0);
+}
+
+std::string queueFlagsString(VkQueueFlags queueFlags)
+{
+    std::string flags;
+    for (const auto bit : {
+        VK_QUEUE_GRAPHICS_BIT,
+        VK_QUEUE_COMPUTE_BIT,
+        VK_QUEUE_TRANSFER_BIT,
+        VK_QUEUE_SPARSE_BINDING_BIT,
+        VK_QUEUE_PROTECTED_BIT})
+    {
+        if (queueFlags & bit)
+        {
+            if (!flags.empty())
+                flags += " | ";
+            flags += magma::helpers::stringize(bit);
+        }
+    }
+    return flags.empty() ? "---" : flags;
+}
+
+std::string sampleCountsString(VkSampleCountFlags sampleCounts)
+{
+    std::string counts;
+    for (uint32_t samples = VK_SAMPLE_COUNT_1_BIT; samples <= VK_SAMPLE_COUNT_64_BIT; samples <<= 1)
+    {
+        if (sampleCounts & samples)
+        {
+            if (!counts.empty())
+                counts += ", ";
+            counts += std::to_string(samples);
+        }
+    }
+    return counts.empty() ? "---" : counts;
+}
+
+std::vector<uint32_t> threadCountSeries()
+{
+    uint32_t maxThreadCount = benchmarkOptions.maxThreadCount;
+    if (!maxThreadCount)
+        maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    if (threadCounts.back() < maxThreadCount)
+        threadCounts.push_back(maxThreadCount);
+    return threadCounts;
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount):
+    arrivedCount(0),
+    beginTimes(threadCount),
+    endTimes(threadCount)
+{
+    for (uint32_t i = 0; i < threadCount; ++i)
+        threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    workReady.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+double ThreadPool::run(const std::function<void(uint32_t)>& func)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    this->func = &func;
+    error = nullptr;
+    arrivedCount = 0;
+    pendingCount = getThreadCount();
+    ++generation;
+    workReady.notify_all();
+    workDone.wait(lock, [this]() { return !pendingCount; });
+    this->func = nullptr;
+    if (error)
+        std::rethrow_exception(error);
+    const auto begin = *std::min_element(beginTimes.begin(), beginTimes.end());
+    const auto end = *std::max_element(endTimes.begin(), endTimes.end());
+    return elapsedMilliseconds(begin, end);
+}
+
+void ThreadPool::work(uint32_t threadIndex)
+{   // Workers aren't confined to CPU of pinned benchmark thread
+    unpinThread();
+    uint64_t lastGeneration = 0;
+    while (true)
+    {
+        const std::function<void(uint32_t)> *func;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady.wait(lock, [&]() { return stop || generation != lastGeneration; });
+            if (stop)
+                return;
+            lastGeneration = generation;
+            func = this->func;
+        }
+        // Start barrier: wake-up latency of workers isn't measured
+        ++arrivedCount;
+        while (arrivedCount < getThreadCount())
+            std::this_thread::yield();
+        beginTimes[threadIndex] = Clock::now();
+        std::exception_ptr threadError;
+        try
+        {
+            (*func)(threadIndex);
+        }
+        catch (...)
+        {
+            threadError = std::current_exception();
+        }
+        endTimes[threadIndex] = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (threadError && !error)
+            error = std::move(threadError);
+        if (!--pendingCount)
+            workDone.notify_one();
+    }
+}
+
+std::string uuidString(const uint8_t uuid[VK_UUID_SIZE])
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string str;
+    for (int i = 0; i < VK_UUID_SIZE; ++i)
+    {
+        if (4 == i || 6 == i || 8 == i || 10 == i)
+            str += '-';
+        str += hex[uuid[i] >> 4];
+        str += hex[uuid[i] & 0xF];
+    }
+    return str;
+}
+
+void printRow(const std::vector<std::string>& cells, int cellWidth /* 15 */)
+{
+    for (const auto& cell : cells)
+        std::cout << std::setw(cellWidth) << std::left << cell;
+    std::cout << std::endl;
+}
+
+void listBenchmarks()
+{
+    printEndLn();
+    setFieldWidth(20);
+    printLn("Name", "Description");
+    for (const auto& benchmark : benchmarks)
+        printLn(benchmark.name, benchmark.description);
+}
+
+void recordResult(const std::string& metric, const Timing& timing)
+{
+    ResultRecord record;
+    record.metric = metric;
+    record.timing = timing;
+    benchmarkResults.push_back(record);
+}
+
+static DeviceFingerprint getFingerprint(magma::PhysicalDevicePtr physicalDevice)
+{
+    const auto properties = physicalDevice->getProperties();
+    DeviceFingerprint fingerprint;
+    fingerprint.vendorID = properties.vendorID;
+    fingerprint.deviceID = properties.deviceID;
+    fingerprint.driverVersion = properties.driverVersion;
+#ifdef VK_KHR_driver_properties
+    auto deviceExtensions = std::make_shared<magma::PhysicalDeviceExtensions>(physicalDevice);
+    if (deviceExtensions->KHR_driver_properties)
+    {
+        const auto driverProperties = physicalDevice->getDriverProperties();
+        fingerprint.driverID = driverProperties.driverID;
+        fingerprint.conformanceVersion[0] = driverProperties.conformanceVersion.major;
+        fingerprint.conformanceVersion[1] = driverProperties.conformanceVersion.minor;
+        fingerprint.conformanceVersion[2] = driverProperties.conformanceVersion.subminor;
+        fingerprint.conformanceVersion[3] = driverProperties.conformanceVersion.patch;
+    }
+#endif // VK_KHR_driver_properties
+    return fingerprint;
+}
+
+// Fingerprint and CPU frequency scaling state that results depend on
+static void printEnvironment(const DeviceFingerprint& fingerprint)
+{
+    const uint32_t cpuIndex = static_cast<uint32_t>(std::max(benchmarkOptions.pinnedCpu, 0));
+    const CpuFrequencyState cpuState = readCpuFrequencyState(cpuIndex);
+    setFieldWidth(20);
+    printLn("Fingerprint", fingerprint.toString());
+    if (!cpuState.governor.empty())
+    {
+        printLn("CPU governor", cpuState.governor);
+        printLn("CPU frequency, MHz", std::to_string(cpuState.currentKHz / 1000) + " (" +
+            std::to_string(cpuState.minKHz / 1000) + "-" + std::to_string(cpuState.maxKHz / 1000) + ")");
+    }
+}
+
+// Returns field of "vendorID:deviceID:driverVersion:driverID:conformance" fingerprint
+static std::string fingerprintField(const std::string& fingerprint, int index)
+{
+    std::istringstream stream(fingerprint);
+    std::string field;
+    for (int i = 0; i <= index; ++i)
+    {
+        if (!std::getline(stream, field, ':'))
+            return std::string();
+    }
+    return field;
+}
+
+// Returns e.g. "470.63.1.0" for fingerprint of NVidia driver
+static std::string fingerprintDriver(const std::string& fingerprint)
+{
+    try
+    {
+        return driverVersionString(static_cast<uint32_t>(std::stoul(fingerprintField(fingerprint, 2), nullptr, 16)),
+            static_cast<uint32_t>(std::stoul(fingerprintField(fingerprint, 0), nullptr, 16)));
+    }
+    catch (const std::logic_error&)
+    {   // std::invalid_argument or std::out_of_range
+        return fingerprintField(fingerprint, 2);
+    }
+}
+
+// Prior runs of the device with driver given by --baseline-driver (decoded or hex version),
+// otherwise with the most recent driver other than current one, so that driver update is compared with previous driver.
+// Runs with current driver are baseline if the device has no others.
+static std::vector<ResultRecord> selectBaseline(const std::vector<ResultRecord>& deviceRecords, const std::string& fingerprint)
+{
+    const std::string& driver = benchmarkOptions.baselineDriver;
+    std::string baselineFingerprint;
+    int64_t baselineTime = 0;
+    for (const auto& record : deviceRecords)
+    {
+        const bool eligible = driver.empty() ? (record.fingerprint != fingerprint) :
+            (driver == fingerprintField(record.fingerprint, 2)) || (driver == fingerprintDriver(record.fingerprint));
+        // Records are in file order, so the last one of equal time is the most recent
+        if (eligible && (baselineFingerprint.empty() || record.time >= baselineTime))
+        {
+            baselineFingerprint = record.fingerprint;
+            baselineTime = record.time;
+        }
+    }
+    if (baselineFingerprint.empty() && driver.empty())
+        baselineFingerprint = fingerprint;
+    std::vector<ResultRecord> baseline;
+    for (const auto& record : deviceRecords)
+    {
+        if (record.fingerprint == baselineFingerprint)
+            baseline.push_back(record);
+    }
+    return baseline;
+}
+
+// Pools prior runs of each metric and reports ones that became significantly slower
+static uint32_t compareWithBaseline(const std::vector<ResultRecord>& baseline, const std::vector<ResultRecord>& results)
+{
+    std::unordered_map<std::string, std::vector<Timing>> priorTimings;
+    for (const auto& record : baseline)
+        priorTimings[record.benchmark + "/" + record.metric].push_back(record.timing);
+    uint32_t comparedCount = 0;
+    uint32_t regressionCount = 0;
+    printEndLn();
+    std::cout << "Baseline comparison" << std::endl;
+    setFieldWidth(20);
+    if (baseline.empty())
+        printLn("Baseline driver", "None");
+    else
+    {
+        printLn("Baseline driver", fingerprintDriver(baseline.front().fingerprint));
+        printLn("Fingerprint", baseline.front().fingerprint);
+    }
+    for (const auto& result : results)
+    {
+        const auto it = priorTimings.find(result.benchmark + "/" + result.metric);
+        if (it == priorTimings.end())
+            continue;
+        ++comparedCount;
+        const Timing pooled = combine(it->second);
+        if (!significantlySlower(pooled, result.timing, benchmarkOptions.regressionThreshold))
+            continue;
+        if (!regressionCount++)
+            printRow({"Regression", "Baseline, ms", "Current, ms", "Change", "Runs"});
+        printRow({
+            result.metric,
+            fixedString(pooled.mean, 4),
+            fixedString(result.timing.mean, 4),
+            "+" + fixedString((result.timing.mean / pooled.mean - 1.) * 100., 1) + "%",
+            std::to_string(it->second.size())});
+    }
+    std::cout << comparedCount << " of " << results.size() << " metrics compared, "
+        << regressionCount << " regressions" << std::endl;
+    return regressionCount;
+}
+
+int runBenchmarks(magma::InstancePtr instance, const std::string& benchmarkName)
+{
+    bool found = false;
+    for (const auto& benchmark : benchmarks)
+        found |= (benchmarkName == "all") || (benchmarkName == benchmark.name);
+    if (!found)
+    {
+        std::cout << "Unknown benchmark \"" << benchmarkName << "\"" << std::endl;
+        listBenchmarks();
+        return -1;
+    }
+    if (benchmarkOptions.pinnedCpu >= 0 && !pinThreadToCpu(static_cast<uint32_t>(benchmarkOptions.pinnedCpu)))
+        std::cout << "Failed to pin benchmark thread to CPU " << benchmarkOptions.pinnedCpu << std::endl;
+    ResultStore resultStore(benchmarkOptions.resultsFile);
+    uint32_t regressionCount = 0;
+    const uint32_t physicalDeviceCount = instance->enumeratePhysicalDevices();
+    for (uint32_t deviceId = 0; deviceId < physicalDeviceCount; ++deviceId)
+    {
+        magma::PhysicalDevicePtr physicalDevice = instance->getPhysicalDevice(deviceId);
+        const auto properties = physicalDevice->getProperties();
+        const DeviceFingerprint fingerprint = getFingerprint(physicalDevice);
+        // Looked up before this run is appended
+        std::vector<ResultRecord> baseline;
+        if (benchmarkOptions.compareBaseline)
+            baseline = selectBaseline(resultStore.findDevice(fingerprint.toString()), fingerprint.toString());
+        for (const auto& benchmark : benchmarks)
+        {
+            if (benchmarkName != "all" && benchmarkName != benchmark.name)
+                continue;
+            printHeading((std::string(benchmark.description) + " (" + std::to_string(deviceId) + ")").c_str());
+            printEndLn();
+            std::cout << properties.deviceName << std::endl;
+            printEnvironment(fingerprint);
+            benchmarkResults.clear();
+            try
+            {
+                benchmark.run(instance, physicalDevice);
+            }
+            catch (const BenchmarkSkipped& skipped)
+            {
+                std::cout << "Skipped: " << skipped.what() << std::endl;
+            }
+            catch (const std::exception& exc)
+            {
+                std::cout << "Error: " << exc.what() << std::endl;
+            }
+            if (benchmarkResults.empty())
+                continue;
+            const int64_t time = static_cast<int64_t>(std::time(nullptr));
+            for (auto& record : benchmarkResults)
+            {
+                record.fingerprint = fingerprint.toString();
+                record.time = time;
+                record.benchmark = benchmark.name;
+            }
+            if (benchmarkOptions.compareBaseline)
+                regressionCount += compareWithBaseline(baseline, benchmarkResults);
+            resultStore.append(benchmarkResults);
+        }
+    }
+    // Non-zero exit code lets scripts detect regressions
+    return regressionCount ? 1 : 0;
+}
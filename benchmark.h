@@ -0,0 +1,330 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include "third-party/magma/magma.h"
+#include "statistics.h"
+
+// Thrown when Vulkan call fails during benchmark run
+class VulkanError : public std::runtime_error
+{
+public:
+    VulkanError(VkResult result, const char *call):
+        std::runtime_error(std::string(call) + " failed with result " + std::to_string(result)),
+        result(result) {}
+    VkResult getResult() const noexcept { return result; }
+
+private:
+    VkResult result;
+};
+
+// Thrown when device doesn't support what benchmark needs
+class BenchmarkSkipped : public std::runtime_error
+{
+public:
+    explicit BenchmarkSkipped(const std::string& reason):
+        std::runtime_error(reason) {}
+};
+
+inline void checkResult(VkResult result, const char *call)
+{
+    if (result < VK_SUCCESS)
+        throw VulkanError(result, call);
+}
+
+// Owns non-dispatchable handle and destroys it with device
+template<typename Handle, void (VKAPI_PTR *destroy)(VkDevice, Handle, const VkAllocationCallbacks *)>
+class Scoped
+{
+public:
+    Scoped() noexcept = default;
+    Scoped(VkDevice device, Handle handle) noexcept:
+        device(device), handle(handle) {}
+    Scoped(Scoped&& other) noexcept:
+        device(other.device), handle(other.handle) { other.handle = VK_NULL_HANDLE; }
+    Scoped& operator=(Scoped&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            device = other.device;
+            handle = other.handle;
+            other.handle = VK_NULL_HANDLE;
+        }
+        return *this;
+    }
+    ~Scoped() { reset(); }
+    void reset() noexcept
+    {
+        if (handle != VK_NULL_HANDLE)
+            destroy(device, handle, nullptr);
+        handle = VK_NULL_HANDLE;
+    }
+    operator Handle() const noexcept { return handle; }
+    const Handle *address() const noexcept { return &handle; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    Handle handle = VK_NULL_HANDLE;
+};
+
+typedef Scoped<VkCommandPool, vkDestroyCommandPool> CommandPool;
+typedef Scoped<VkFence, vkDestroyFence> Fence;
+typedef Scoped<VkSemaphore, vkDestroySemaphore> Semaphore;
+typedef Scoped<VkEvent, vkDestroyEvent> Event;
+typedef Scoped<VkQueryPool, vkDestroyQueryPool> QueryPool;
+typedef Scoped<VkShaderModule, vkDestroyShaderModule> ShaderModule;
+typedef Scoped<VkDeviceMemory, vkFreeMemory> DeviceMemory;
+typedef Scoped<VkBuffer, vkDestroyBuffer> BufferHandle;
+typedef Scoped<VkDescriptorSetLayout, vkDestroyDescriptorSetLayout> DescriptorSetLayout;
+typedef Scoped<VkPipelineLayout, vkDestroyPipelineLayout> PipelineLayout;
+typedef Scoped<VkPipelineCache, vkDestroyPipelineCache> PipelineCache;
+typedef Scoped<VkPipeline, vkDestroyPipeline> Pipeline;
+typedef Scoped<VkRenderPass, vkDestroyRenderPass> RenderPass;
+typedef Scoped<VkImage, vkDestroyImage> ImageHandle;
+typedef Scoped<VkImageView, vkDestroyImageView> ImageView;
+typedef Scoped<VkFramebuffer, vkDestroyFramebuffer> Framebuffer;
+typedef Scoped<VkDescriptorPool, vkDestroyDescriptorPool> DescriptorPool;
+typedef Scoped<VkSampler, vkDestroySampler> Sampler;
+
+// Buffer with its own dedicated memory, mapped if host visible
+struct Buffer
+{
+    DeviceMemory memory;
+    BufferHandle buffer;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    void *data = nullptr;
+    operator VkBuffer() const noexcept { return buffer; }
+};
+
+// Device local image with its own dedicated memory and default view
+struct Image
+{
+    DeviceMemory memory;
+    ImageHandle image;
+    ImageView view;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {0, 0, 0};
+    uint32_t mipLevels = 1;
+    operator VkImage() const noexcept { return image; }
+};
+
+struct DeviceOptions
+{
+    VkPhysicalDeviceFeatures features = {};
+    std::vector<const char *> extensions;
+    void *extendedFeatures = nullptr;
+    // If more than one, logical device is created for the whole group
+    std::vector<VkPhysicalDevice> deviceGroup;
+};
+
+// Logical device with one queue from every queue family
+class DeviceContext
+{
+public:
+    explicit DeviceContext(VkPhysicalDevice physicalDevice,
+        const DeviceOptions& options = DeviceOptions());
+    ~DeviceContext();
+    DeviceContext(const DeviceContext&) = delete;
+    DeviceContext& operator=(const DeviceContext&) = delete;
+
+    VkDevice getDevice() const noexcept { return device; }
+    VkPhysicalDevice getPhysicalDevice() const noexcept { return physicalDevice; }
+    const VkPhysicalDeviceProperties& getProperties() const noexcept { return properties; }
+    const VkPhysicalDeviceLimits& getLimits() const noexcept { return properties.limits; }
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept { return memoryProperties; }
+    const std::vector<VkQueueFamilyProperties>& getQueueFamilies() const noexcept { return queueFamilies; }
+    uint32_t getDeviceCount() const noexcept { return deviceCount; }
+    bool extensionEnabled(const char *extensionName) const noexcept;
+
+    // Returns UINT32_MAX if there is no such family; exact matches are preferred
+    uint32_t findQueueFamily(VkQueueFlags flags, VkQueueFlags excludedFlags = 0) const noexcept;
+    VkQueue getQueue(uint32_t queueFamilyIndex) const noexcept { return queues[queueFamilyIndex]; }
+    // Returns UINT32_MAX if there is no such memory type
+    uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags flags) const noexcept;
+    // Memory types allowed for buffers of given usage
+    uint32_t getBufferMemoryTypeBits(VkBufferUsageFlags usage) const;
+
+    Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags) const;
+    Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryTypeIndex, const void *allocateNext) const;
+    CommandPool createCommandPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags = 0) const;
+    VkCommandBuffer allocateCommandBuffer(VkCommandPool commandPool,
+        VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) const;
+    Fence createFence(bool signaled = false) const;
+    Semaphore createSemaphore(const void *next = nullptr) const;
+    Event createEvent() const;
+    QueryPool createQueryPool(VkQueryType queryType, uint32_t queryCount) const;
+    Image createImage(VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage,
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT, uint32_t mipLevels = 1) const;
+    Framebuffer createFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& attachments,
+        uint32_t width, uint32_t height) const;
+    ShaderModule createShaderModule(const uint32_t *code, std::size_t size) const;
+    Sampler createSampler(VkFilter filter, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT) const;
+    DescriptorSetLayout createDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+        VkDescriptorSetLayoutCreateFlags flags = 0, const void *next = nullptr) const;
+    PipelineLayout createPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts,
+        const std::vector<VkPushConstantRange>& pushConstantRanges = {}) const;
+    DescriptorPool createDescriptorPool(uint32_t maxSets, const std::vector<VkDescriptorPoolSize>& poolSizes,
+        VkDescriptorPoolCreateFlags flags = 0, const void *next = nullptr) const;
+    VkDescriptorSet allocateDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout setLayout,
+        const void *next = nullptr) const;
+    Pipeline createComputePipeline(VkShaderModule shader, const VkSpecializationInfo *specialization,
+        VkPipelineLayout layout, VkPipelineCache pipelineCache = VK_NULL_HANDLE) const;
+    // Single color attachment that is cleared and stored
+    RenderPass createRenderPass(VkFormat colorFormat, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT) const;
+    // Pipeline without vertex input that has dynamic viewport and scissor
+    Pipeline createGraphicsPipeline(VkShaderModule vertexShader, VkShaderModule fragmentShader,
+        const VkSpecializationInfo *fragmentSpecialization, VkPipelineLayout layout, VkRenderPass renderPass,
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT, VkPipelineCache pipelineCache = VK_NULL_HANDLE) const;
+
+    void submit(VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence, const void *next = nullptr) const;
+    void waitAndReset(VkFence fence) const;
+    // Submits and waits until execution is complete, returns elapsed CPU time in milliseconds
+    double submitAndWait(VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence, const void *next = nullptr) const;
+    // Returns difference of two timestamp queries in milliseconds
+    double timestampDelta(uint64_t begin, uint64_t end) const noexcept;
+
+    // Looks up core entry point first, then one with KHR suffix
+    template<typename Proc>
+    Proc getProc(const char *name) const
+    {
+        PFN_vkVoidFunction proc = vkGetDeviceProcAddr(device, name);
+        if (!proc)
+            proc = vkGetDeviceProcAddr(device, (std::string(name) + "KHR").c_str());
+        return reinterpret_cast<Proc>(proc);
+    }
+
+private:
+    Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags,
+        uint32_t memoryTypeIndex, const void *allocateNext) const;
+
+    VkPhysicalDevice physicalDevice;
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    std::vector<VkQueueFamilyProperties> queueFamilies;
+    std::vector<VkQueue> queues;
+    std::vector<std::string> enabledExtensions;
+    uint32_t deviceCount = 1;
+};
+
+inline void beginCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags flags = 0,
+    const VkCommandBufferInheritanceInfo *inheritanceInfo = nullptr)
+{
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = flags;
+    beginInfo.pInheritanceInfo = inheritanceInfo;
+    checkResult(vkBeginCommandBuffer(commandBuffer, &beginInfo), "vkBeginCommandBuffer");
+}
+
+inline void endCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    checkResult(vkEndCommandBuffer(commandBuffer), "vkEndCommandBuffer");
+}
+
+bool deviceExtensionSupported(VkPhysicalDevice physicalDevice, const char *extensionName);
+// Highest API version supported by the loader, VK_API_VERSION_1_0 for 1.0 loader
+uint32_t enumerateInstanceVersion();
+// Defined in gpucaps.cpp next to subgroup report; returns false unless both instance and device are Vulkan 1.1
+bool getSubgroupProperties(VkInstance instance, VkPhysicalDevice physicalDevice,
+    VkPhysicalDeviceSubgroupProperties& subgroupProperties);
+std::string queueFlagsString(VkQueueFlags queueFlags);
+// Returns e.g. "1, 2, 4, 8"
+std::string sampleCountsString(VkSampleCountFlags sampleCounts);
+std::string uuidString(const uint8_t uuid[VK_UUID_SIZE]);
+// Defined in gpucaps.cpp
+std::string driverVersionString(uint32_t driverVersion, uint32_t vendorID);
+// Prints table row with cells of equal width
+void printRow(const std::vector<std::string>& cells, int cellWidth = 15);
+
+struct BenchmarkOptions
+{
+    uint32_t maxThreadCount = 0; // Hardware concurrency if zero
+    uint32_t commandCount = 1000; // Commands per command buffer
+    std::string calibrationFile = "calibration.jsonl"; // Timestamp calibration records are appended here
+    int pinnedCpu = -1; // Benchmark thread is pinned to this logical CPU unless negative
+    std::string resultsFile = "results.jsonl"; // Results of every run are appended here
+    bool compareBaseline = false; // Compare results with prior runs on the same device
+    std::string baselineDriver; // Driver of baseline runs; most recent other driver if empty
+    double regressionThreshold = .05; // Smaller slowdowns are not reported as regressions
+};
+
+extern BenchmarkOptions benchmarkOptions;
+
+// Returns 1, 2, 4 ... up to max thread count
+std::vector<uint32_t> threadCountSeries();
+
+// Persistent worker threads, so that thread creation isn't part of measured work
+class ThreadPool
+{
+public:
+    explicit ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t getThreadCount() const noexcept { return static_cast<uint32_t>(threads.size()); }
+    // Calls func(threadIndex) on every worker and rethrows first exception.
+    // Workers are released together by start barrier; returns milliseconds
+    // from the first worker starting its work to the last one finishing it.
+    double run(const std::function<void(uint32_t)>& func);
+
+private:
+    void work(uint32_t threadIndex);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    const std::function<void(uint32_t)> *func = nullptr;
+    uint64_t generation = 0;
+    uint32_t pendingCount = 0;
+    std::atomic<uint32_t> arrivedCount;
+    std::vector<Clock::time_point> beginTimes;
+    std::vector<Clock::time_point> endTimes;
+    std::exception_ptr error;
+    bool stop = false;
+};
+
+// Stores timing of benchmark metric to be appended to results file
+void recordResult(const std::string& metric, const Timing& timing);
+
+inline double gigabytesPerSecond(VkDeviceSize size, double milliseconds) noexcept
+{
+    return milliseconds > 0. ? (size / 1e9) / (milliseconds / 1e3) : 0.;
+}
+
+typedef void (*BenchmarkFunc)(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+
+struct Benchmark
+{
+    const char *name;
+    const char *description;
+    BenchmarkFunc run;
+};
+
+void listBenchmarks();
+int runBenchmarks(magma::InstancePtr instance, const std::string& benchmarkName);
+
+void benchmarkDeviceGroup(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkPipelines(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkCommandBuffers(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkDescriptors(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkSubgroups(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkCalibration(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkNonCoherentMemory(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkTextures(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkSparseBinding(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkAsyncCompute(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkIndirect(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkMsaa(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkConstants(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
+void benchmarkSynchronization(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice);
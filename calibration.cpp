@@ -0,0 +1,265 @@
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "results.h"
+
+static const uint32_t sampleCount = 100;
+static const std::chrono::milliseconds sampleInterval(20);
+
+// Device timestamp paired with host time of the same moment
+struct CalibrationSample
+{
+    uint64_t deviceTicks;
+    uint64_t hostNanoseconds;
+    double deviationNanoseconds; // Uncertainty of the pairing
+    double costMicroseconds; // CPU time spent to get the pair
+};
+
+// Linear mapping from device ticks to host nanoseconds:
+// host = referenceHostNanoseconds + slope * (ticks - referenceDeviceTicks) * timestampPeriod
+struct Calibration
+{
+    const char *method;
+    std::vector<CalibrationSample> samples;
+    uint64_t referenceDeviceTicks = 0;
+    double referenceHostNanoseconds = 0.;
+    double slope = 1.;
+    double residualNanoseconds = 0.;
+};
+
+static uint64_t hostNanoseconds() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static const char *hostTimeDomainName() noexcept
+{
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+    return "QueryPerformanceCounter";
+#else
+    return "CLOCK_MONOTONIC";
+#endif
+}
+
+// Least squares fit of host time against device time, relative to the first sample
+static void fitCalibration(Calibration& calibration, double timestampPeriod)
+{
+    const std::vector<CalibrationSample>& samples = calibration.samples;
+    const CalibrationSample& first = samples.front();
+    const double n = static_cast<double>(samples.size());
+    double sumX = 0., sumY = 0., sumXX = 0., sumXY = 0.;
+    for (const auto& sample : samples)
+    {
+        const double x = (sample.deviceTicks - first.deviceTicks) * timestampPeriod;
+        const double y = static_cast<double>(static_cast<int64_t>(sample.hostNanoseconds - first.hostNanoseconds));
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    const double denominator = n * sumXX - sumX * sumX;
+    const double slope = denominator > 0. ? (n * sumXY - sumX * sumY) / denominator : 1.;
+    const double intercept = (sumY - slope * sumX) / n;
+    double sumResidual = 0.;
+    for (const auto& sample : samples)
+    {
+        const double x = (sample.deviceTicks - first.deviceTicks) * timestampPeriod;
+        const double y = static_cast<double>(static_cast<int64_t>(sample.hostNanoseconds - first.hostNanoseconds));
+        const double residual = y - (intercept + slope * x);
+        sumResidual += residual * residual;
+    }
+    calibration.referenceDeviceTicks = first.deviceTicks;
+    calibration.referenceHostNanoseconds = first.hostNanoseconds + intercept;
+    calibration.slope = slope;
+    calibration.residualNanoseconds = std::sqrt(sumResidual / n);
+}
+
+#ifdef VK_EXT_calibrated_timestamps
+static VkTimeDomainEXT hostTimeDomain() noexcept
+{
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+    return VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+    return VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+}
+
+static bool calibrateableTimeDomainsSupported(VkInstance instance, VkPhysicalDevice physicalDevice)
+{
+    auto getPhysicalDeviceCalibrateableTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+    if (!getPhysicalDeviceCalibrateableTimeDomains)
+        return false;
+    uint32_t timeDomainCount = 0;
+    getPhysicalDeviceCalibrateableTimeDomains(physicalDevice, &timeDomainCount, nullptr);
+    std::vector<VkTimeDomainEXT> timeDomains(timeDomainCount);
+    getPhysicalDeviceCalibrateableTimeDomains(physicalDevice, &timeDomainCount, timeDomains.data());
+    return std::count(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_DEVICE_EXT) &&
+        std::count(timeDomains.begin(), timeDomains.end(), hostTimeDomain());
+}
+
+// Driver samples both clocks as close together as it can and reports deviation
+static Calibration calibrateTimestamps(const DeviceContext& context)
+{
+    auto getCalibratedTimestamps = context.getProc<PFN_vkGetCalibratedTimestampsEXT>("vkGetCalibratedTimestampsEXT");
+    if (!getCalibratedTimestamps)
+        throw BenchmarkSkipped("vkGetCalibratedTimestampsEXT not available");
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+#endif
+    VkCalibratedTimestampInfoEXT timestampInfos[2] = {};
+    timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[1].timeDomain = hostTimeDomain();
+    Calibration calibration;
+    calibration.method = "calibrated_timestamps";
+    for (uint32_t i = 0; i < sampleCount; ++i)
+    {
+        uint64_t timestamps[2];
+        uint64_t maxDeviation;
+        const auto begin = Clock::now();
+        checkResult(getCalibratedTimestamps(context.getDevice(), 2, timestampInfos, timestamps, &maxDeviation),
+            "vkGetCalibratedTimestampsEXT");
+        const auto end = Clock::now();
+        CalibrationSample sample;
+        sample.deviceTicks = timestamps[0];
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+        sample.hostNanoseconds = static_cast<uint64_t>(timestamps[1] * (1e9 / frequency.QuadPart));
+#else
+        sample.hostNanoseconds = timestamps[1];
+#endif
+        sample.deviationNanoseconds = static_cast<double>(maxDeviation);
+        sample.costMicroseconds = elapsedMilliseconds(begin, end) * 1e3;
+        calibration.samples.push_back(sample);
+        std::this_thread::sleep_for(sampleInterval);
+    }
+    return calibration;
+}
+#endif // VK_EXT_calibrated_timestamps
+
+// Timestamp written at the top of pipe is somewhere between submit and fence signal
+static Calibration estimateTimestamps(const DeviceContext& context, uint32_t queueFamilyIndex)
+{
+    const VkQueue queue = context.getQueue(queueFamilyIndex);
+    CommandPool commandPool = context.createCommandPool(queueFamilyIndex);
+    QueryPool queryPool = context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 1);
+    Fence fence = context.createFence();
+    VkCommandBuffer commandBuffer = context.allocateCommandBuffer(commandPool);
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    endCommandBuffer(commandBuffer);
+    context.submitAndWait(queue, commandBuffer, fence); // Warm up
+    Calibration calibration;
+    calibration.method = "submit_fence";
+    for (uint32_t i = 0; i < sampleCount; ++i)
+    {
+        const uint64_t submitTime = hostNanoseconds();
+        context.submitAndWait(queue, commandBuffer, fence);
+        const uint64_t signalTime = hostNanoseconds();
+        uint64_t timestamp;
+        checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, 1, sizeof(uint64_t), &timestamp, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+        CalibrationSample sample;
+        sample.deviceTicks = timestamp;
+        sample.hostNanoseconds = submitTime + (signalTime - submitTime)/2;
+        sample.deviationNanoseconds = (signalTime - submitTime) / 2.;
+        sample.costMicroseconds = (signalTime - submitTime) / 1e3;
+        calibration.samples.push_back(sample);
+        std::this_thread::sleep_for(sampleInterval);
+    }
+    return calibration;
+}
+
+// Appends one JSON object per line, so that records of several devices and runs accumulate
+static void writeCalibrationRecord(const std::string& fileName, const DeviceContext& context,
+    const Calibration& calibration, uint32_t timestampValidBits)
+{
+    const VkPhysicalDeviceProperties& properties = context.getProperties();
+    std::ostringstream record;
+    record.precision(17);
+    record << "{\"device\":" << jsonString(properties.deviceName)
+        << ",\"vendorID\":" << properties.vendorID
+        << ",\"deviceID\":" << properties.deviceID
+        << ",\"driverVersion\":" << properties.driverVersion
+        << ",\"method\":" << jsonString(calibration.method)
+        << ",\"hostTimeDomain\":" << jsonString(hostTimeDomainName())
+        << ",\"timestampPeriod\":" << properties.limits.timestampPeriod
+        << ",\"timestampValidBits\":" << timestampValidBits
+        << ",\"referenceDeviceTicks\":" << calibration.referenceDeviceTicks
+        << ",\"referenceHostNanoseconds\":" << calibration.referenceHostNanoseconds
+        << ",\"slope\":" << calibration.slope
+        << ",\"residualNanoseconds\":" << calibration.residualNanoseconds
+        << ",\"samples\":[";
+    for (std::size_t i = 0; i < calibration.samples.size(); ++i)
+    {
+        const CalibrationSample& sample = calibration.samples[i];
+        record << (i ? "," : "") << "[" << sample.deviceTicks << "," << sample.hostNanoseconds << ","
+            << sample.deviationNanoseconds << "]";
+    }
+    record << "]}";
+    std::ofstream file(fileName, std::ios::app);
+    if (!file)
+        throw std::runtime_error("failed to open " + fileName);
+    file << record.str() << std::endl;
+}
+
+void benchmarkCalibration(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    bool calibrateable = false;
+    DeviceOptions options;
+#ifdef VK_EXT_calibrated_timestamps
+    calibrateable = deviceExtensionSupported(physicalDevice->getHandle(), VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) &&
+        calibrateableTimeDomainsSupported(instance->getHandle(), physicalDevice->getHandle());
+    if (calibrateable)
+        options.extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+#else
+    MAGMA_UNUSED(instance);
+#endif
+    DeviceContext context(physicalDevice->getHandle(), options);
+    // Device time domain is the one of vkCmdWriteTimestamp on any queue
+    uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
+    if (UINT32_MAX == queueFamilyIndex)
+        queueFamilyIndex = context.findQueueFamily(VK_QUEUE_COMPUTE_BIT);
+    const uint32_t timestampValidBits = context.getQueueFamilies()[queueFamilyIndex].timestampValidBits;
+    if (!calibrateable && !timestampValidBits)
+        throw BenchmarkSkipped("neither calibrated timestamps nor timestamp queries supported");
+    const double timestampPeriod = context.getLimits().timestampPeriod;
+#ifdef VK_EXT_calibrated_timestamps
+    Calibration calibration = calibrateable ? calibrateTimestamps(context) : estimateTimestamps(context, queueFamilyIndex);
+#else
+    Calibration calibration = estimateTimestamps(context, queueFamilyIndex);
+#endif
+    fitCalibration(calibration, timestampPeriod);
+    std::vector<double> deviations, costs;
+    for (const auto& sample : calibration.samples)
+    {
+        deviations.push_back(sample.deviationNanoseconds);
+        costs.push_back(sample.costMicroseconds);
+    }
+    const Timing deviation = summarize(std::move(deviations));
+    const Timing cost = summarize(std::move(costs));
+    const CalibrationSample& first = calibration.samples.front();
+    const CalibrationSample& last = calibration.samples.back();
+    const double offsetNanoseconds = calibration.referenceHostNanoseconds - calibration.referenceDeviceTicks * timestampPeriod;
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Method", calibration.method);
+    printLn("Host time domain", hostTimeDomainName());
+    printLn("Timestamp period, ns", timestampPeriod);
+    printLn("Timestamp valid bits", timestampValidBits);
+    printLn("Samples", calibration.samples.size());
+    printLn("Duration, ms", fixedString((last.hostNanoseconds - first.hostNanoseconds) / 1e6, 1));
+    printEndLn();
+    printLn("Host - device offset, ms", fixedString(offsetNanoseconds / 1e6, 6));
+    printLn("Drift, ppm", fixedString((calibration.slope - 1.) * 1e6, 3));
+    printLn("Residual RMS, us", fixedString(calibration.residualNanoseconds / 1e3, 3));
+    printLn("Deviation, us", fixedString(deviation.median / 1e3, 3) + " median, " + fixedString(deviation.max / 1e3, 3) + " max");
+    printLn("Calibration cost, us", fixedString(cost.median, 3) + " median, " + fixedString(cost.max, 3) + " max");
+    writeCalibrationRecord(benchmarkOptions.calibrationFile, context, calibration, timestampValidBits);
+    printLn("Calibration record", benchmarkOptions.calibrationFile);
+}
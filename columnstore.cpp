@@ -0,0 +1,701 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cctype>
+#include <map>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "columnstore.h"
+
+static uint32_t popcount(uint64_t word) noexcept
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<uint32_t>(__popcnt64(word));
+#elif defined(_MSC_VER)
+    return __popcnt(static_cast<uint32_t>(word)) + __popcnt(static_cast<uint32_t>(word >> 32));
+#else
+    return static_cast<uint32_t>(__builtin_popcountll(word));
+#endif
+}
+
+// Word must not be zero
+static uint32_t trailingZeros(uint64_t word) noexcept
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<uint32_t>(word)))
+        return index;
+    _BitScanForward(&index, static_cast<uint32_t>(word >> 32));
+    return index + 32;
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+}
+
+static void setBit(std::vector<uint64_t>& bitmap, uint64_t index) noexcept
+{
+    bitmap[index / 64] |= 1ull << (index % 64);
+}
+
+static bool testBit(const std::vector<uint64_t>& bitmap, uint64_t index) noexcept
+{
+    return (bitmap[index / 64] >> (index % 64)) & 1;
+}
+
+// Calls func(row) for each set bit
+template<typename Func>
+static void forEachRow(const Bitmap& selection, Func func)
+{
+    for (std::size_t i = 0; i < selection.size(); ++i)
+    {
+        for (uint64_t word = selection[i]; word; word &= word - 1)
+            func(i * 64 + trailingZeros(word));
+    }
+}
+
+static std::string trim(const std::string& str)
+{
+    const std::size_t begin = str.find_first_not_of(" \t");
+    if (std::string::npos == begin)
+        return std::string();
+    const std::size_t end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+// Lower case without spaces, underscores and dashes
+static std::string normalize(const std::string& name)
+{
+    std::string normalized;
+    for (char c : name)
+    {
+        if (c != ' ' && c != '_' && c != '-')
+            normalized += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return normalized;
+}
+
+static bool parseNumber(const std::string& str, double& number)
+{
+    if (str.empty())
+        return false;
+    char *end;
+    if (str.size() > 2 && '0' == str[0] && ('x' == str[1] || 'X' == str[1]))
+        number = static_cast<double>(std::strtoull(str.c_str() + 2, &end, 16));
+    else
+        number = std::strtod(str.c_str(), &end);
+    return '\0' == *end;
+}
+
+static std::string numberString(double number)
+{
+    std::ostringstream str;
+    str.precision(15);
+    str << number;
+    return str.str();
+}
+
+static ColumnStore::Type valueType(const std::string& value)
+{
+    double number;
+    if ("Yes" == value || "No" == value)
+        return ColumnStore::Type::Boolean;
+    if (parseNumber(value, number))
+        return ColumnStore::Type::Number;
+    return ColumnStore::Type::String;
+}
+
+// Heading is "===== Title =====", see printHeading()
+static bool parseHeading(const std::string& line, std::string& heading)
+{
+    if (line.size() < 2 || line.front() != '=' || line.back() != '=')
+        return false;
+    const std::size_t begin = line.find_first_not_of('=');
+    const std::size_t end = line.find_last_not_of('=');
+    if (std::string::npos == begin)
+        return false;
+    heading = trim(line.substr(begin, end - begin + 1));
+    return true;
+}
+
+// Device heading is "Device name (index)", see printDeviceProperties()
+static bool parseDeviceHeading(const std::string& heading, std::string& deviceName)
+{
+    const std::size_t open = heading.rfind(" (");
+    if (std::string::npos == open || heading.back() != ')' || open + 3 > heading.size())
+        return false;
+    for (std::size_t i = open + 2; i < heading.size() - 1; ++i)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(heading[i])))
+            return false;
+    }
+    deviceName = heading.substr(0, open);
+    return true;
+}
+
+uint32_t ColumnStore::ingest(std::istream& snapshot)
+{
+    Fields instanceFields, deviceFields;
+    std::string section, subsection, lastKey;
+    std::size_t valueColumn = 0; // Field width of section, see setFieldWidth()
+    bool device = false;
+    uint32_t deviceCount = 0;
+    auto addField = [&](const std::string& key, const std::string& value)
+    {
+        std::string name = section + "/";
+        if (!subsection.empty())
+            name += subsection + "/";
+        (device ? deviceFields : instanceFields).emplace_back(name + key, value);
+    };
+    std::string line, heading, deviceName;
+    while (std::getline(snapshot, line))
+    {
+        if (!line.empty() && '\r' == line.back())
+            line.pop_back();
+        if (parseHeading(line, heading))
+        {
+            subsection.clear();
+            lastKey.clear();
+            valueColumn = 0;
+            if (parseDeviceHeading(heading, deviceName))
+            {
+                if (device)
+                {
+                    appendRow(deviceFields);
+                    ++deviceCount;
+                }
+                device = true;
+                deviceFields = instanceFields;
+                section = "Device";
+                addField("Name", deviceName);
+            }
+            else
+                section = heading;
+            continue;
+        }
+        // Layers and device groups are not properties of a single device
+        if (section.empty() || line.empty() || "Instance Layers" == section || "Device Groups" == section)
+            continue;
+        if ('#' == line[0])
+        {   // Queue family, memory type or heap index
+            subsection = trim(line);
+            lastKey.clear();
+            continue;
+        }
+        if ('\t' == line[0])
+        {   // Flag listed under previous key
+            if (!lastKey.empty())
+                addField(lastKey + "/" + trim(line), "Yes");
+            continue;
+        }
+        std::size_t separator = line.find("  ");
+        if (separator != std::string::npos)
+            valueColumn = line.find_first_not_of(' ', separator);
+        else if (valueColumn && line.size() > valueColumn && ' ' == line[valueColumn - 1])
+            separator = valueColumn; // Key one character shorter than field width
+        if (std::string::npos == separator)
+        {   // Key without value is followed by flags
+            lastKey = trim(line);
+            continue;
+        }
+        const std::string key = trim(line.substr(0, separator));
+        const std::string value = trim(line.substr(separator));
+        const bool extensions = "Instance Extensions" == section || "Device Extensions" == section;
+        if (extensions && "Name" == key)
+            continue;
+        addField(key, extensions ? "Yes" : value);
+        lastKey = key;
+    }
+    if (device)
+    {
+        appendRow(deviceFields);
+        ++deviceCount;
+    }
+    return deviceCount;
+}
+
+static void resize(ColumnStore::Column& column, uint64_t rowCount)
+{
+    const std::size_t wordCount = static_cast<std::size_t>((rowCount + 63) / 64);
+    column.validity.resize(wordCount);
+    switch (column.type)
+    {
+    case ColumnStore::Type::Boolean:
+        column.bits.resize(wordCount);
+        break;
+    case ColumnStore::Type::Number:
+        column.numbers.resize(static_cast<std::size_t>(rowCount));
+        break;
+    case ColumnStore::Type::String:
+        column.codes.resize(static_cast<std::size_t>(rowCount));
+        break;
+    }
+}
+
+static uint32_t encodeString(ColumnStore::Column& column, const std::string& value)
+{
+    const auto it = column.dictionaryCodes.find(value);
+    if (it != column.dictionaryCodes.end())
+        return it->second;
+    const uint32_t code = static_cast<uint32_t>(column.dictionary.size());
+    column.dictionary.push_back(value);
+    column.dictionaryCodes[value] = code;
+    return code;
+}
+
+// Dictionary encodes text of existing values
+static void convertToString(ColumnStore::Column& column, uint64_t rowCount)
+{
+    resize(column, rowCount);
+    std::vector<uint32_t> codes(static_cast<std::size_t>(rowCount));
+    for (uint64_t row = 0; row < rowCount; ++row)
+    {
+        if (!testBit(column.validity, row))
+            continue;
+        if (ColumnStore::Type::Boolean == column.type)
+            codes[row] = encodeString(column, testBit(column.bits, row) ? "Yes" : "No");
+        else
+            codes[row] = encodeString(column, numberString(column.numbers[row]));
+    }
+    column.type = ColumnStore::Type::String;
+    column.codes.swap(codes);
+    column.bits.clear();
+    column.numbers.clear();
+}
+
+void ColumnStore::appendRow(const Fields& fields)
+{
+    const uint64_t row = rowCount++;
+    for (const auto& field : fields)
+    {
+        const std::string& value = field.second;
+        Column *column = getColumn(field.first, valueType(value));
+        resize(*column, rowCount);
+        setBit(column->validity, row);
+        switch (column->type)
+        {
+        case Type::Boolean:
+            if ("Yes" == value)
+                setBit(column->bits, row);
+            break;
+        case Type::Number:
+            parseNumber(value, column->numbers[row]);
+            break;
+        case Type::String:
+            column->codes[row] = encodeString(*column, value);
+            break;
+        }
+    }
+    for (auto& column : columns)
+        resize(column, rowCount);
+}
+
+ColumnStore::Column *ColumnStore::getColumn(const std::string& name, Type type)
+{
+    const auto it = columnIndices.find(name);
+    if (it != columnIndices.end())
+    {
+        Column& column = columns[it->second];
+        if (column.type != type && column.type != Type::String)
+            convertToString(column, rowCount);
+        return &column;
+    }
+    columnIndices[name] = columns.size();
+    columns.emplace_back();
+    Column& column = columns.back();
+    column.name = name;
+    column.type = type;
+    resize(column, rowCount);
+    return &column;
+}
+
+const ColumnStore::Column *ColumnStore::findColumn(const std::string& name) const
+{
+    const auto it = columnIndices.find(name);
+    if (it != columnIndices.end())
+        return &columns[it->second];
+    const std::string key = normalize(name);
+    const Column *found = nullptr;
+    for (const auto& column : columns)
+    {   // Trailing path components, e.g. "Queue flags/VK_QUEUE_GRAPHICS_BIT"
+        const std::string normalized = normalize(column.name);
+        if (normalized.size() < key.size())
+            continue;
+        const std::size_t pos = normalized.size() - key.size();
+        if (normalized.compare(pos, key.size(), key) != 0 || (pos && normalized[pos - 1] != '/'))
+            continue;
+        if (found)
+            throw std::invalid_argument("ambiguous column \"" + name + "\": " + found->name + ", " + column.name + "...");
+        found = &column;
+    }
+    return found;
+}
+
+// Native byte order; the store is a local cache rebuilt from snapshots
+template<typename Type>
+static void writeValue(std::ostream& stream, const Type& value)
+{
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(Type));
+}
+
+template<typename Type>
+static void readValue(std::istream& stream, Type& value)
+{
+    stream.read(reinterpret_cast<char *>(&value), sizeof(Type));
+}
+
+template<typename Type>
+static void writeArray(std::ostream& stream, const std::vector<Type>& array)
+{
+    writeValue(stream, static_cast<uint64_t>(array.size()));
+    stream.write(reinterpret_cast<const char *>(array.data()), array.size() * sizeof(Type));
+}
+
+template<typename Type>
+static void readArray(std::istream& stream, std::vector<Type>& array)
+{
+    uint64_t size = 0;
+    readValue(stream, size);
+    array.resize(static_cast<std::size_t>(size));
+    stream.read(reinterpret_cast<char *>(array.data()), array.size() * sizeof(Type));
+}
+
+static void writeString(std::ostream& stream, const std::string& str)
+{
+    writeValue(stream, static_cast<uint32_t>(str.size()));
+    stream.write(str.data(), str.size());
+}
+
+static void readString(std::istream& stream, std::string& str)
+{
+    uint32_t size = 0;
+    readValue(stream, size);
+    str.resize(size);
+    stream.read(&str[0], size);
+}
+
+static const uint32_t storeMagic = 0x58494347; // "GCIX"
+static const uint32_t storeVersion = 1;
+
+void ColumnStore::save(const std::string& fileName) const
+{
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("failed to open " + fileName);
+    writeValue(file, storeMagic);
+    writeValue(file, storeVersion);
+    writeValue(file, rowCount);
+    writeValue(file, static_cast<uint32_t>(columns.size()));
+    for (const auto& column : columns)
+    {
+        writeString(file, column.name);
+        writeValue(file, column.type);
+        writeArray(file, column.validity);
+        writeArray(file, column.bits);
+        writeArray(file, column.numbers);
+        writeArray(file, column.codes);
+        writeValue(file, static_cast<uint32_t>(column.dictionary.size()));
+        for (const auto& str : column.dictionary)
+            writeString(file, str);
+    }
+    if (!file.flush())
+        throw std::runtime_error("failed to write " + fileName);
+}
+
+void ColumnStore::load(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("failed to open " + fileName);
+    uint32_t magic = 0, version = 0, columnCount = 0;
+    readValue(file, magic);
+    readValue(file, version);
+    if (magic != storeMagic || version != storeVersion)
+        throw std::runtime_error(fileName + " is not a gpucaps index");
+    readValue(file, rowCount);
+    readValue(file, columnCount);
+    columns.resize(columnCount);
+    columnIndices.clear();
+    for (uint32_t i = 0; i < columnCount; ++i)
+    {
+        Column& column = columns[i];
+        readString(file, column.name);
+        readValue(file, column.type);
+        readArray(file, column.validity);
+        readArray(file, column.bits);
+        readArray(file, column.numbers);
+        readArray(file, column.codes);
+        uint32_t dictionarySize = 0;
+        readValue(file, dictionarySize);
+        column.dictionary.resize(dictionarySize);
+        column.dictionaryCodes.clear();
+        for (uint32_t code = 0; code < dictionarySize; ++code)
+        {
+            readString(file, column.dictionary[code]);
+            column.dictionaryCodes[column.dictionary[code]] = code;
+        }
+        columnIndices[column.name] = i;
+    }
+    if (!file)
+        throw std::runtime_error(fileName + " is truncated");
+}
+
+// Branch-free scan that builds 64 rows of selection at a time
+template<typename Value, typename Compare>
+static void scan(const std::vector<Value>& values, Value operand, Compare compare, Bitmap& mask)
+{
+    const std::size_t count = values.size();
+    for (std::size_t word = 0; word < mask.size(); ++word)
+    {
+        const std::size_t begin = word * 64;
+        const std::size_t end = std::min(begin + 64, count);
+        uint64_t bits = 0;
+        for (std::size_t i = begin; i < end; ++i)
+            bits |= static_cast<uint64_t>(compare(values[i], operand)) << (i - begin);
+        mask[word] = bits;
+    }
+}
+
+template<typename Value>
+static void compareValues(const std::vector<Value>& values, const std::string& op, Value operand, Bitmap& mask)
+{
+    if ("==" == op)
+        scan(values, operand, [](Value a, Value b) { return a == b; }, mask);
+    else if ("!=" == op)
+        scan(values, operand, [](Value a, Value b) { return a != b; }, mask);
+    else if ("<" == op)
+        scan(values, operand, [](Value a, Value b) { return a < b; }, mask);
+    else if ("<=" == op)
+        scan(values, operand, [](Value a, Value b) { return a <= b; }, mask);
+    else if (">" == op)
+        scan(values, operand, [](Value a, Value b) { return a > b; }, mask);
+    else
+        scan(values, operand, [](Value a, Value b) { return a >= b; }, mask);
+}
+
+// Accepts K, M and G binary suffixes, e.g. 48K
+static double parseOperand(const std::string& str)
+{
+    double multiplier = 1.;
+    std::string digits = str;
+    switch (str.empty() ? '\0' : str.back())
+    {
+    case 'K': case 'k': multiplier = 1024.; break;
+    case 'M': case 'm': multiplier = 1024. * 1024.; break;
+    case 'G': case 'g': multiplier = 1024. * 1024. * 1024.; break;
+    }
+    if (multiplier > 1.)
+        digits.pop_back();
+    double number;
+    if (!parseNumber(digits, number))
+        throw std::invalid_argument("\"" + str + "\" is not a number");
+    return number * multiplier;
+}
+
+static std::vector<std::string> splitConjunction(const std::string& expression)
+{
+    std::vector<std::string> predicates;
+    std::size_t begin = 0;
+    const std::string lower = [&]() {
+        std::string str = expression;
+        std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return str;
+    }();
+    while (true)
+    {
+        const std::size_t andPos = lower.find(" and ", begin);
+        const std::size_t ampersandPos = lower.find("&&", begin);
+        const std::size_t end = std::min(andPos, ampersandPos);
+        predicates.push_back(trim(expression.substr(begin, end - begin)));
+        if (std::string::npos == end)
+            break;
+        begin = end + (end == andPos ? 5 : 2);
+    }
+    return predicates;
+}
+
+// Selection of rows for which single predicate holds
+static Bitmap evaluate(const ColumnStore& store, const std::string& predicate)
+{
+    static const char *operators[] = {"==", "!=", "<=", ">=", "\xE2\x89\xA4" /* ≤ */, "\xE2\x89\xA5" /* ≥ */, "<", ">", "="};
+    std::string name = predicate, op, operand;
+    for (const char *candidate : operators)
+    {
+        const std::size_t pos = predicate.find(candidate);
+        if (pos != std::string::npos)
+        {
+            name = trim(predicate.substr(0, pos));
+            op = candidate;
+            operand = trim(predicate.substr(pos + op.size()));
+            break;
+        }
+    }
+    if ("\xE2\x89\xA4" == op)
+        op = "<=";
+    else if ("\xE2\x89\xA5" == op)
+        op = ">=";
+    else if ("=" == op)
+        op = "==";
+    bool negate = false;
+    if (op.empty() && !name.empty() && '!' == name[0])
+    {
+        negate = true;
+        name = trim(name.substr(1));
+    }
+    const std::size_t wordCount = static_cast<std::size_t>((store.getRowCount() + 63) / 64);
+    Bitmap mask(wordCount, 0);
+    const ColumnStore::Column *column = store.findColumn(name);
+    if (!column)
+    {   // Extension that no device has
+        if (op.empty() && normalize(name).compare(0, 2, "vk") == 0)
+        {
+            if (negate)
+                std::fill(mask.begin(), mask.end(), ~0ull);
+            return mask;
+        }
+        throw std::invalid_argument("unknown column \"" + name + "\"");
+    }
+    switch (column->type)
+    {
+    case ColumnStore::Type::Boolean:
+        if (op.empty())
+        {
+            for (std::size_t i = 0; i < wordCount; ++i)
+                mask[i] = column->bits[i] & column->validity[i];
+        }
+        else
+        {
+            if (op != "==" && op != "!=")
+                throw std::invalid_argument("boolean \"" + name + "\" can only be compared for equality");
+            const std::string lower = normalize(operand);
+            const bool value = ("yes" == lower || "true" == lower || "1" == lower);
+            negate = (value != ("==" == op));
+            for (std::size_t i = 0; i < wordCount; ++i)
+                mask[i] = (negate ? ~column->bits[i] : column->bits[i]) & column->validity[i];
+            return mask;
+        }
+        break;
+    case ColumnStore::Type::Number:
+        if (op.empty())
+            throw std::invalid_argument("number \"" + name + "\" needs comparison");
+        compareValues(column->numbers, op, parseOperand(operand), mask);
+        for (std::size_t i = 0; i < wordCount; ++i)
+            mask[i] &= column->validity[i];
+        break;
+    case ColumnStore::Type::String:
+        if (op != "==" && op != "!=")
+            throw std::invalid_argument("string \"" + name + "\" can only be compared for equality");
+        {
+            const auto it = column->dictionaryCodes.find(operand);
+            if (it != column->dictionaryCodes.end())
+                compareValues(column->codes, op, it->second, mask);
+            else if ("!=" == op)
+                std::fill(mask.begin(), mask.end(), ~0ull);
+            for (std::size_t i = 0; i < wordCount; ++i)
+                mask[i] &= column->validity[i];
+        }
+        break;
+    }
+    if (negate)
+    {
+        for (auto& word : mask)
+            word = ~word;
+    }
+    return mask;
+}
+
+Bitmap filter(const ColumnStore& store, const std::string& expression)
+{
+    const uint64_t rowCount = store.getRowCount();
+    Bitmap selection(static_cast<std::size_t>((rowCount + 63) / 64), ~0ull);
+    if (!trim(expression).empty())
+    {
+        for (const auto& predicate : splitConjunction(expression))
+        {
+            const Bitmap mask = evaluate(store, predicate);
+            for (std::size_t i = 0; i < selection.size(); ++i)
+                selection[i] &= mask[i];
+        }
+    }
+    // Clear bits past the last row
+    if (rowCount % 64)
+        selection.back() &= (1ull << (rowCount % 64)) - 1;
+    return selection;
+}
+
+uint64_t countRows(const Bitmap& selection)
+{
+    uint64_t count = 0;
+    for (uint64_t word : selection)
+        count += popcount(word);
+    return count;
+}
+
+std::vector<Group> groupBy(const ColumnStore& store, const Bitmap& selection, const std::string& columnName)
+{
+    const ColumnStore::Column *column = store.findColumn(columnName);
+    if (!column)
+        throw std::invalid_argument("unknown column \"" + columnName + "\"");
+    std::vector<Group> groups;
+    uint64_t nullCount = 0;
+    switch (column->type)
+    {
+    case ColumnStore::Type::Boolean:
+        {
+            uint64_t yesCount = 0, validCount = 0;
+            for (std::size_t i = 0; i < selection.size(); ++i)
+            {
+                yesCount += popcount(selection[i] & column->validity[i] & column->bits[i]);
+                validCount += popcount(selection[i] & column->validity[i]);
+            }
+            groups.push_back({"Yes", yesCount});
+            groups.push_back({"No", validCount - yesCount});
+            nullCount = countRows(selection) - validCount;
+        }
+        break;
+    case ColumnStore::Type::Number:
+        {
+            std::map<double, uint64_t> counts;
+            forEachRow(selection,
+                [&](std::size_t row)
+                {
+                    if (testBit(column->validity, row))
+                        ++counts[column->numbers[row]];
+                    else
+                        ++nullCount;
+                });
+            for (const auto& count : counts)
+                groups.push_back({numberString(count.first), count.second});
+        }
+        break;
+    case ColumnStore::Type::String:
+        {
+            std::vector<uint64_t> counts(column->dictionary.size());
+            forEachRow(selection,
+                [&](std::size_t row)
+                {
+                    if (testBit(column->validity, row))
+                        ++counts[column->codes[row]];
+                    else
+                        ++nullCount;
+                });
+            for (std::size_t code = 0; code < counts.size(); ++code)
+            {
+                if (counts[code])
+                    groups.push_back({column->dictionary[code], counts[code]});
+            }
+        }
+        break;
+    }
+    if (nullCount)
+        groups.push_back({"(none)", nullCount});
+    std::stable_sort(groups.begin(), groups.end(),
+        [](const Group& a, const Group& b) { return a.count > b.count; });
+    return groups;
+}
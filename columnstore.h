@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <istream>
+#include <cstdint>
+
+// Row is a physical device from gpucaps snapshot, column is a capability.
+// Booleans (features, extensions, flags) are bitmaps, numbers are arrays of doubles,
+// strings are dictionary encoded. Absent values are tracked by validity bitmap.
+class ColumnStore
+{
+public:
+    enum class Type : uint8_t
+    {
+        Boolean, Number, String
+    };
+
+    struct Column
+    {
+        std::string name; // Section/Key, e.g. "Device Limits/Max compute shared memory size"
+        Type type;
+        std::vector<uint64_t> validity;
+        std::vector<uint64_t> bits; // Boolean
+        std::vector<double> numbers; // Number
+        std::vector<uint32_t> codes; // String
+        std::vector<std::string> dictionary;
+        std::unordered_map<std::string, uint32_t> dictionaryCodes;
+    };
+
+    // Adds one row per device in gpucaps text output, returns number of added rows
+    uint32_t ingest(std::istream& snapshot);
+    void save(const std::string& fileName) const;
+    void load(const std::string& fileName);
+    uint64_t getRowCount() const noexcept { return rowCount; }
+    const std::vector<Column>& getColumns() const noexcept { return columns; }
+    // Matches full name or its trailing components ignoring case, spaces and underscores,
+    // e.g. maxComputeSharedMemorySize.
+    // Returns nullptr if name is unknown, throws if it is ambiguous.
+    const Column *findColumn(const std::string& name) const;
+
+private:
+    typedef std::vector<std::pair<std::string, std::string>> Fields;
+    void appendRow(const Fields& fields);
+    // Column that has values of different type is converted to String,
+    // e.g. sample count limits were numbers in older snapshots
+    Column *getColumn(const std::string& name, Type type);
+
+    uint64_t rowCount = 0;
+    std::vector<Column> columns;
+    std::unordered_map<std::string, std::size_t> columnIndices;
+};
+
+// Selected rows, one bit per row
+typedef std::vector<uint64_t> Bitmap;
+
+// Conjunction of predicates separated by "and", e.g.
+// "maxComputeSharedMemorySize >= 48K and descriptorBindingPartiallyBound and !VK_KHR_ray_query".
+// Operators are ==, !=, <, <=, >, >=; numbers may have K, M or G suffix.
+Bitmap filter(const ColumnStore& store, const std::string& expression);
+uint64_t countRows(const Bitmap& selection);
+
+struct Group
+{
+    std::string value;
+    uint64_t count;
+};
+
+// Counts selected rows by value of column, most frequent first
+std::vector<Group> groupBy(const ColumnStore& store, const Bitmap& selection, const std::string& columnName);
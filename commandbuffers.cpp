@@ -0,0 +1,364 @@
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/pipeline.comp.h"
+#include "shaders/fullscreen.vert.h"
+#include "shaders/pipeline.frag.h"
+
+static const uint32_t commandBuffersPerFrame = 64;
+static const uint32_t frameCount = 10;
+static const uint32_t framebufferSize = 64;
+
+enum class PoolStrategy
+{
+    ResetPool,
+    ResetBuffer,
+    FreeAllocate,
+    Secondary
+};
+
+static const PoolStrategy strategies[] = {
+    PoolStrategy::ResetPool,
+    PoolStrategy::ResetBuffer,
+    PoolStrategy::FreeAllocate,
+    PoolStrategy::Secondary
+};
+
+static const char *strategyName(PoolStrategy strategy)
+{
+    switch (strategy)
+    {
+    case PoolStrategy::ResetPool: return "Reset pool";
+    case PoolStrategy::ResetBuffer: return "Reset buffer";
+    case PoolStrategy::FreeAllocate: return "Free/allocate";
+    case PoolStrategy::Secondary: return "Secondary";
+    }
+    return "";
+}
+
+// Commands recorded into every command buffer
+struct CommandMix
+{
+    uint32_t draws = 0;
+    uint32_t dispatches = 0;
+    uint32_t barriers = 0;
+    uint32_t binds = 0;
+    uint32_t total() const noexcept { return draws + dispatches + barriers + binds; }
+};
+
+// Half of draws and dispatches rebind descriptor set, so binds are a quarter of commands
+static CommandMix commandMix(uint32_t commandCount, bool graphics)
+{
+    CommandMix mix;
+    const uint32_t quarter = std::max(1u, commandCount/4);
+    mix.draws = graphics ? quarter : 0;
+    mix.dispatches = graphics ? quarter : quarter * 2;
+    mix.barriers = quarter;
+    mix.binds = (mix.draws + 1)/2 + (mix.dispatches + 1)/2;
+    return mix;
+}
+
+// Objects referenced by recorded commands
+struct RecordingScene
+{
+    RecordingScene(const DeviceContext& context);
+
+    RenderPass renderPass;
+    Image colorImage;
+    Framebuffer framebuffer;
+    ShaderModule computeShader;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    DescriptorSetLayout descriptorSetLayout;
+    PipelineLayout pipelineLayout;
+    Pipeline graphicsPipeline;
+    Pipeline computePipeline;
+    Buffer storageBuffer;
+    DescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+};
+
+RecordingScene::RecordingScene(const DeviceContext& context):
+    renderPass(context.createRenderPass(VK_FORMAT_R8G8B8A8_UNORM)),
+    colorImage(context.createImage(VK_FORMAT_R8G8B8A8_UNORM, framebufferSize, framebufferSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)),
+    framebuffer(context.createFramebuffer(renderPass, {colorImage.view}, framebufferSize, framebufferSize)),
+    computeShader(context.createShaderModule(pipeline_comp, sizeof(pipeline_comp))),
+    vertexShader(context.createShaderModule(fullscreen_vert, sizeof(fullscreen_vert))),
+    fragmentShader(context.createShaderModule(pipeline_frag, sizeof(pipeline_frag))),
+    storageBuffer(context.createBuffer(4096, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_ALL;
+    descriptorSetLayout = context.createDescriptorSetLayout({binding});
+    pipelineLayout = context.createPipelineLayout({descriptorSetLayout});
+    graphicsPipeline = context.createGraphicsPipeline(vertexShader, fragmentShader, nullptr, pipelineLayout, renderPass);
+    computePipeline = context.createComputePipeline(computeShader, nullptr, pipelineLayout);
+    descriptorPool = context.createDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+    descriptorSet = context.allocateDescriptorSet(descriptorPool, descriptorSetLayout);
+    VkDescriptorBufferInfo bufferInfo = {storageBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
+static void recordDraws(VkCommandBuffer commandBuffer, const RecordingScene& scene, const CommandMix& mix)
+{
+    const VkViewport viewport = {0.f, 0.f, float(framebufferSize), float(framebufferSize), 0.f, 1.f};
+    const VkRect2D scissor = {{0, 0}, {framebufferSize, framebufferSize}};
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.graphicsPipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    for (uint32_t i = 0; i < mix.draws; ++i)
+    {
+        if (i % 2 == 0)
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    }
+}
+
+static void recordDispatches(VkCommandBuffer commandBuffer, const RecordingScene& scene, const CommandMix& mix)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scene.computePipeline);
+    for (uint32_t i = 0; i < std::max(mix.dispatches, mix.barriers); ++i)
+    {
+        if (i < mix.dispatches)
+        {
+            if (i % 2 == 0)
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr);
+            vkCmdDispatch(commandBuffer, 1, 1, 1);
+        }
+        if (i < mix.barriers)
+        {
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                1, &barrier, 0, nullptr, 0, nullptr);
+        }
+    }
+}
+
+static void beginRenderPass(VkCommandBuffer commandBuffer, const RecordingScene& scene, VkSubpassContents contents)
+{
+    const VkClearValue clearValue = {};
+    VkRenderPassBeginInfo renderPassBeginInfo = {};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = scene.renderPass;
+    renderPassBeginInfo.framebuffer = scene.framebuffer;
+    renderPassBeginInfo.renderArea = {{0, 0}, {framebufferSize, framebufferSize}};
+    renderPassBeginInfo.clearValueCount = 1;
+    renderPassBeginInfo.pClearValues = &clearValue;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, contents);
+}
+
+static void recordPrimary(VkCommandBuffer commandBuffer, const RecordingScene& scene, const CommandMix& mix)
+{
+    beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    if (mix.draws)
+    {
+        beginRenderPass(commandBuffer, scene, VK_SUBPASS_CONTENTS_INLINE);
+        recordDraws(commandBuffer, scene, mix);
+        vkCmdEndRenderPass(commandBuffer);
+    }
+    recordDispatches(commandBuffer, scene, mix);
+    endCommandBuffer(commandBuffer);
+}
+
+// Draws go to secondary that continues render pass, dispatches and barriers go to another one
+static void recordSecondaries(VkCommandBuffer drawCommandBuffer, VkCommandBuffer dispatchCommandBuffer,
+    const RecordingScene& scene, const CommandMix& mix)
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if (mix.draws)
+    {
+        inheritanceInfo.renderPass = scene.renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = scene.framebuffer;
+        beginCommandBuffer(drawCommandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inheritanceInfo);
+        recordDraws(drawCommandBuffer, scene, mix);
+        endCommandBuffer(drawCommandBuffer);
+    }
+    inheritanceInfo.renderPass = VK_NULL_HANDLE;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+    beginCommandBuffer(dispatchCommandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, &inheritanceInfo);
+    recordDispatches(dispatchCommandBuffer, scene, mix);
+    endCommandBuffer(dispatchCommandBuffer);
+}
+
+// Command pool and command buffers owned by one recording thread
+struct ThreadCommands
+{
+    CommandPool commandPool;
+    std::vector<VkCommandBuffer> commandBuffers;
+    std::vector<VkCommandBuffer> drawSecondaries;
+    std::vector<VkCommandBuffer> dispatchSecondaries;
+};
+
+static std::vector<VkCommandBuffer> allocateCommandBuffers(const DeviceContext& context, VkCommandPool commandPool,
+    uint32_t count, VkCommandBufferLevel level)
+{
+    std::vector<VkCommandBuffer> commandBuffers(count);
+    if (count)
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = level;
+        allocInfo.commandBufferCount = count;
+        checkResult(vkAllocateCommandBuffers(context.getDevice(), &allocInfo, commandBuffers.data()), "vkAllocateCommandBuffers");
+    }
+    return commandBuffers;
+}
+
+// Records one frame on every thread of the pool, returns elapsed milliseconds
+static double recordFrame(const DeviceContext& context, const RecordingScene& scene, const CommandMix& mix,
+    PoolStrategy strategy, ThreadPool& threadPool, std::vector<ThreadCommands>& threads, VkCommandBuffer primary)
+{
+    const VkDevice device = context.getDevice();
+    const double recordTime = threadPool.run(
+        [&](uint32_t threadIndex)
+        {
+            ThreadCommands& thread = threads[threadIndex];
+            switch (strategy)
+            {
+            case PoolStrategy::ResetPool:
+                checkResult(vkResetCommandPool(device, thread.commandPool, 0), "vkResetCommandPool");
+                for (VkCommandBuffer commandBuffer : thread.commandBuffers)
+                    recordPrimary(commandBuffer, scene, mix);
+                break;
+            case PoolStrategy::ResetBuffer:
+                for (VkCommandBuffer commandBuffer : thread.commandBuffers)
+                {
+                    checkResult(vkResetCommandBuffer(commandBuffer, 0), "vkResetCommandBuffer");
+                    recordPrimary(commandBuffer, scene, mix);
+                }
+                break;
+            case PoolStrategy::FreeAllocate:
+                {
+                    const uint32_t count = static_cast<uint32_t>(thread.commandBuffers.size());
+                    if (count)
+                        vkFreeCommandBuffers(device, thread.commandPool, count, thread.commandBuffers.data());
+                    thread.commandBuffers = allocateCommandBuffers(context, thread.commandPool, count, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+                    for (VkCommandBuffer commandBuffer : thread.commandBuffers)
+                        recordPrimary(commandBuffer, scene, mix);
+                }
+                break;
+            case PoolStrategy::Secondary:
+                checkResult(vkResetCommandPool(device, thread.commandPool, 0), "vkResetCommandPool");
+                for (std::size_t i = 0; i < thread.dispatchSecondaries.size(); ++i)
+                    recordSecondaries(thread.drawSecondaries[i], thread.dispatchSecondaries[i], scene, mix);
+                break;
+            }
+        });
+    if (PoolStrategy::Secondary != strategy)
+        return recordTime;
+    // Primary command buffer executes what threads have recorded
+    const auto begin = Clock::now();
+    std::vector<VkCommandBuffer> drawSecondaries, dispatchSecondaries;
+    for (const auto& thread : threads)
+    {
+        drawSecondaries.insert(drawSecondaries.end(), thread.drawSecondaries.begin(), thread.drawSecondaries.end());
+        dispatchSecondaries.insert(dispatchSecondaries.end(), thread.dispatchSecondaries.begin(), thread.dispatchSecondaries.end());
+    }
+    checkResult(vkResetCommandBuffer(primary, 0), "vkResetCommandBuffer");
+    beginCommandBuffer(primary, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    if (mix.draws)
+    {
+        beginRenderPass(primary, scene, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(primary, static_cast<uint32_t>(drawSecondaries.size()), drawSecondaries.data());
+        vkCmdEndRenderPass(primary);
+    }
+    vkCmdExecuteCommands(primary, static_cast<uint32_t>(dispatchSecondaries.size()), dispatchSecondaries.data());
+    endCommandBuffer(primary);
+    return recordTime + elapsedMilliseconds(begin, Clock::now());
+}
+
+static Timing benchmarkStrategy(const DeviceContext& context, const RecordingScene& scene, uint32_t queueFamilyIndex,
+    const CommandMix& mix, PoolStrategy strategy, uint32_t threadCount)
+{
+    const VkCommandPoolCreateFlags flags = (PoolStrategy::ResetBuffer == strategy)
+        ? VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+        : VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    ThreadPool threadPool(threadCount);
+    std::vector<ThreadCommands> threads(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {   // Command buffers of the frame are spread evenly over threads
+        const uint32_t count = commandBuffersPerFrame/threadCount + (i < commandBuffersPerFrame % threadCount ? 1 : 0);
+        ThreadCommands& thread = threads[i];
+        thread.commandPool = context.createCommandPool(queueFamilyIndex, flags);
+        if (PoolStrategy::Secondary == strategy)
+        {
+            thread.drawSecondaries = allocateCommandBuffers(context, thread.commandPool, count, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+            thread.dispatchSecondaries = allocateCommandBuffers(context, thread.commandPool, count, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        }
+        else
+            thread.commandBuffers = allocateCommandBuffers(context, thread.commandPool, count, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    }
+    CommandPool primaryPool = context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    VkCommandBuffer primary = context.allocateCommandBuffer(primaryPool);
+    return measureSamples(frameCount,
+        [&]()
+        {
+            return recordFrame(context, scene, mix, strategy, threadPool, threads, primary);
+        });
+}
+
+void benchmarkCommandBuffers(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    DeviceContext context(physicalDevice->getHandle());
+    RecordingScene scene(context);
+    const std::vector<uint32_t> threadCounts = threadCountSeries();
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Commands per command buffer", benchmarkOptions.commandCount);
+    printLn("Command buffers per frame", commandBuffersPerFrame);
+    const auto& queueFamilies = context.getQueueFamilies();
+    for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilies.size(); ++queueFamilyIndex)
+    {
+        const VkQueueFamilyProperties& properties = queueFamilies[queueFamilyIndex];
+        const bool graphics = (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        if (!graphics && !(properties.queueFlags & VK_QUEUE_COMPUTE_BIT))
+            continue;
+        const CommandMix mix = commandMix(benchmarkOptions.commandCount, graphics);
+        printEndLn();
+        std::cout << "#" << queueFamilyIndex << std::endl << std::endl;
+        printLn("Queue flags", queueFlagsString(properties.queueFlags));
+        printLn("Queue count", properties.queueCount);
+        printLn("Draws/dispatches/barriers/binds", std::to_string(mix.draws) + "/" + std::to_string(mix.dispatches) + "/" +
+            std::to_string(mix.barriers) + "/" + std::to_string(mix.binds));
+        printEndLn();
+        std::cout << "Million commands/s (scaling efficiency)" << std::endl;
+        std::vector<std::string> header = {"Threads"};
+        for (PoolStrategy strategy : strategies)
+            header.push_back(strategyName(strategy));
+        printRow(header, 18);
+        std::vector<double> singleThreadRates;
+        for (uint32_t threadCount : threadCounts)
+        {
+            std::vector<std::string> row = {std::to_string(threadCount)};
+            for (std::size_t i = 0; i < sizeof(strategies)/sizeof(strategies[0]); ++i)
+            {
+                const Timing timing = benchmarkStrategy(context, scene, queueFamilyIndex, mix, strategies[i], threadCount);
+                recordResult("queue family=" + std::to_string(queueFamilyIndex) + "/threads=" + std::to_string(threadCount) +
+                    "/" + strategyName(strategies[i]), timing);
+                const double rate = (double)mix.total() * commandBuffersPerFrame / (timing.median * 1e3);
+                if (1 == threadCount)
+                    singleThreadRates.push_back(rate);
+                const double efficiency = rate / (singleThreadRates[i] * threadCount) * 100.;
+                row.push_back(fixedString(rate, 2) + " (" + fixedString(efficiency, 0) + "%)");
+            }
+            printRow(row, 18);
+        }
+    }
+}
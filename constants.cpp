@@ -0,0 +1,319 @@
+#include <array>
+#include <cstring>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/push_constants.vert.h"
+#include "shaders/uniform_constants.vert.h"
+#include "shaders/pipeline.frag.h"
+
+static const uint32_t drawCounts[] = {10000, 100000, 1000000};
+// Distinct per-draw data is limited to this many objects, later draws reuse it
+static const uint32_t objectCount = 8192;
+static const uint32_t framebufferSize = 64;
+static const uint32_t repeatCount = 5;
+
+typedef std::array<float, 16> Transform;
+
+enum class ConstantsPath
+{
+    PushConstants,
+    DynamicUniformBuffer,
+    InlineUniformBlock
+};
+
+static const char *pathName(ConstantsPath path)
+{
+    switch (path)
+    {
+    case ConstantsPath::PushConstants: return "Push constants";
+    case ConstantsPath::DynamicUniformBuffer: return "Dynamic UBO";
+    case ConstantsPath::InlineUniformBlock: return "Inline block";
+    }
+    return "";
+}
+
+struct ConstantsResult
+{
+    Timing record; // Includes writing of per-object data
+    Timing gpu;
+};
+
+// Every draw gets its own transform, and covers a single pixel
+class ConstantsScene
+{
+public:
+    ConstantsScene(const DeviceContext& context, uint32_t queueFamilyIndex, bool inlineUniformBlock);
+    ConstantsResult run(ConstantsPath path, uint32_t drawCount);
+
+private:
+    void record(ConstantsPath path, uint32_t drawCount);
+    double submit();
+
+    const DeviceContext& context;
+    const VkQueue queue;
+    std::vector<Transform> transforms;
+    uint32_t ringStride;
+    RenderPass renderPass;
+    Image colorImage;
+    Framebuffer framebuffer;
+    ShaderModule pushVertexShader;
+    ShaderModule uniformVertexShader;
+    ShaderModule fragmentShader;
+    PipelineLayout pushLayout;
+    Pipeline pushPipeline;
+    Buffer ringBuffer;
+    DescriptorSetLayout ringSetLayout;
+    PipelineLayout ringLayout;
+    Pipeline ringPipeline;
+    DescriptorPool ringDescriptorPool;
+    VkDescriptorSet ringDescriptorSet;
+    DescriptorSetLayout inlineSetLayout;
+    PipelineLayout inlineLayout;
+    Pipeline inlinePipeline;
+    DescriptorPool inlineDescriptorPool;
+    std::vector<VkDescriptorSet> inlineDescriptorSets;
+    CommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    QueryPool queryPool;
+    Fence fence;
+};
+
+ConstantsScene::ConstantsScene(const DeviceContext& context, uint32_t queueFamilyIndex, bool inlineUniformBlock):
+    context(context),
+    queue(context.getQueue(queueFamilyIndex)),
+    transforms(objectCount),
+    renderPass(context.createRenderPass(VK_FORMAT_R8G8B8A8_UNORM)),
+    colorImage(context.createImage(VK_FORMAT_R8G8B8A8_UNORM, framebufferSize, framebufferSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)),
+    framebuffer(context.createFramebuffer(renderPass, {colorImage.view}, framebufferSize, framebufferSize)),
+    pushVertexShader(context.createShaderModule(push_constants_vert, sizeof(push_constants_vert))),
+    uniformVertexShader(context.createShaderModule(uniform_constants_vert, sizeof(uniform_constants_vert))),
+    fragmentShader(context.createShaderModule(pipeline_frag, sizeof(pipeline_frag))),
+    commandPool(context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+    queryPool(context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 2)),
+    fence(context.createFence())
+{
+    for (uint32_t i = 0; i < objectCount; ++i)
+    {   // Column-major translation
+        transforms[i] = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f};
+        transforms[i][12] = (i % 64) / 64.f;
+        transforms[i][13] = (i / 64 % 64) / 64.f;
+    }
+    const int32_t iterations = 1;
+    const VkSpecializationMapEntry mapEntry = {0, 0, sizeof(int32_t)};
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &mapEntry;
+    specializationInfo.dataSize = sizeof(int32_t);
+    specializationInfo.pData = &iterations;
+    const VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Transform)};
+    pushLayout = context.createPipelineLayout({}, {pushConstantRange});
+    pushPipeline = context.createGraphicsPipeline(pushVertexShader, fragmentShader, &specializationInfo, pushLayout, renderPass);
+    // Ring of per-object uniforms, selected by dynamic offset
+    const uint32_t alignment = static_cast<uint32_t>(context.getLimits().minUniformBufferOffsetAlignment);
+    ringStride = (sizeof(Transform) + alignment - 1) / alignment * alignment;
+    ringBuffer = context.createBuffer(objectCount * ringStride, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    ringSetLayout = context.createDescriptorSetLayout({binding});
+    ringLayout = context.createPipelineLayout({ringSetLayout});
+    ringPipeline = context.createGraphicsPipeline(uniformVertexShader, fragmentShader, &specializationInfo, ringLayout, renderPass);
+    ringDescriptorPool = context.createDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}});
+    ringDescriptorSet = context.allocateDescriptorSet(ringDescriptorPool, ringSetLayout);
+    const VkDescriptorBufferInfo bufferInfo = {ringBuffer, 0, sizeof(Transform)};
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = ringDescriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+#ifdef VK_EXT_inline_uniform_block
+    if (inlineUniformBlock)
+    {   // Descriptor count of inline uniform block is its size in bytes
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT;
+        binding.descriptorCount = sizeof(Transform);
+        inlineSetLayout = context.createDescriptorSetLayout({binding});
+        inlineLayout = context.createPipelineLayout({inlineSetLayout});
+        inlinePipeline = context.createGraphicsPipeline(uniformVertexShader, fragmentShader, &specializationInfo, inlineLayout, renderPass);
+        VkDescriptorPoolInlineUniformBlockCreateInfoEXT inlinePoolInfo = {};
+        inlinePoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_INLINE_UNIFORM_BLOCK_CREATE_INFO_EXT;
+        inlinePoolInfo.maxInlineUniformBlockBindings = objectCount;
+        inlineDescriptorPool = context.createDescriptorPool(objectCount,
+            {{VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT, objectCount * static_cast<uint32_t>(sizeof(Transform))}}, 0, &inlinePoolInfo);
+        for (uint32_t i = 0; i < objectCount; ++i)
+            inlineDescriptorSets.push_back(context.allocateDescriptorSet(inlineDescriptorPool, inlineSetLayout));
+    }
+#else
+    MAGMA_UNUSED(inlineUniformBlock);
+#endif // VK_EXT_inline_uniform_block
+    commandBuffer = context.allocateCommandBuffer(commandPool);
+}
+
+ConstantsResult ConstantsScene::run(ConstantsPath path, uint32_t drawCount)
+{
+    ConstantsResult result;
+    result.record = measure(repeatCount, [&]() { record(path, drawCount); });
+    result.gpu = measureSamples(repeatCount, [this]() { return submit(); });
+    return result;
+}
+
+// Per-object data is written by host before recording, like renderer would do every frame
+void ConstantsScene::record(ConstantsPath path, uint32_t drawCount)
+{
+    const uint32_t distinctCount = std::min(drawCount, objectCount);
+    if (ConstantsPath::DynamicUniformBuffer == path)
+    {
+        for (uint32_t i = 0; i < distinctCount; ++i)
+            memcpy(static_cast<char *>(ringBuffer.data) + i * ringStride, transforms[i].data(), sizeof(Transform));
+    }
+#ifdef VK_EXT_inline_uniform_block
+    else if (ConstantsPath::InlineUniformBlock == path)
+    {
+        std::vector<VkWriteDescriptorSetInlineUniformBlockEXT> inlineWrites(distinctCount);
+        std::vector<VkWriteDescriptorSet> descriptorWrites(distinctCount);
+        for (uint32_t i = 0; i < distinctCount; ++i)
+        {
+            inlineWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_INLINE_UNIFORM_BLOCK_EXT;
+            inlineWrites[i].pNext = nullptr;
+            inlineWrites[i].dataSize = sizeof(Transform);
+            inlineWrites[i].pData = transforms[i].data();
+            descriptorWrites[i] = {};
+            descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i].pNext = &inlineWrites[i];
+            descriptorWrites[i].dstSet = inlineDescriptorSets[i];
+            descriptorWrites[i].dstBinding = 0;
+            descriptorWrites[i].descriptorCount = sizeof(Transform);
+            descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT;
+        }
+        vkUpdateDescriptorSets(context.getDevice(), distinctCount, descriptorWrites.data(), 0, nullptr);
+    }
+#endif // VK_EXT_inline_uniform_block
+    const VkClearValue clearValue = {};
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea = {{0, 0}, {framebufferSize, framebufferSize}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    const VkViewport viewport = {0.f, 0.f, float(framebufferSize), float(framebufferSize), 0.f, 1.f};
+    const VkRect2D scissor = {{0, 0}, {1, 1}};
+    // Submitted repeatedly by run(), so it isn't one-time submit
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    switch (path)
+    {
+    case ConstantsPath::PushConstants:
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pushPipeline);
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            vkCmdPushConstants(commandBuffer, pushLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Transform),
+                transforms[i % objectCount].data());
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
+        break;
+    case ConstantsPath::DynamicUniformBuffer:
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ringPipeline);
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            const uint32_t dynamicOffset = i % objectCount * ringStride;
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ringLayout, 0, 1, &ringDescriptorSet, 1, &dynamicOffset);
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
+        break;
+    case ConstantsPath::InlineUniformBlock:
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, inlinePipeline);
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, inlineLayout, 0, 1, &inlineDescriptorSets[i % objectCount], 0, nullptr);
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
+        break;
+    }
+    vkCmdEndRenderPass(commandBuffer);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    endCommandBuffer(commandBuffer);
+}
+
+// Returns GPU time between two timestamps in milliseconds
+double ConstantsScene::submit()
+{
+    context.submitAndWait(queue, commandBuffer, fence);
+    uint64_t timestamps[2];
+    checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+    return context.timestampDelta(timestamps[0], timestamps[1]);
+}
+
+void benchmarkConstants(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    DeviceOptions options;
+    bool inlineUniformBlock = false;
+#ifdef VK_EXT_inline_uniform_block
+    auto deviceExtensions = std::make_shared<magma::PhysicalDeviceExtensions>(physicalDevice);
+    VkPhysicalDeviceInlineUniformBlockFeaturesEXT inlineUniformBlockFeatures = {};
+    if (deviceExtensions->EXT_inline_uniform_block && physicalDevice->getInlineUniformBlockFeatures().inlineUniformBlock)
+    {   // Enable only what is measured
+        inlineUniformBlockFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INLINE_UNIFORM_BLOCK_FEATURES_EXT;
+        inlineUniformBlockFeatures.inlineUniformBlock = VK_TRUE;
+        options.extendedFeatures = &inlineUniformBlockFeatures;
+        options.extensions.push_back(VK_EXT_INLINE_UNIFORM_BLOCK_EXTENSION_NAME);
+        // Required by inline uniform block extension
+        if (deviceExtensionSupported(physicalDevice->getHandle(), VK_KHR_MAINTENANCE1_EXTENSION_NAME))
+            options.extensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+        inlineUniformBlock = true;
+    }
+#endif // VK_EXT_inline_uniform_block
+    DeviceContext context(physicalDevice->getHandle(), options);
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
+    if (UINT32_MAX == queueFamilyIndex)
+        throw BenchmarkSkipped("no graphics queue family");
+    if (!context.getQueueFamilies()[queueFamilyIndex].timestampValidBits)
+        throw BenchmarkSkipped("timestamps not supported by graphics queue");
+    ConstantsScene scene(context, queueFamilyIndex, inlineUniformBlock);
+    const VkPhysicalDeviceLimits& limits = context.getLimits();
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Bytes per draw", sizeof(Transform));
+    printLn("Distinct objects", objectCount);
+    printLn("Max push constants size", limits.maxPushConstantsSize);
+    printLn("Min UBO offset alignment", limits.minUniformBufferOffsetAlignment);
+    printLn("Inline uniform block", booleanString(inlineUniformBlock));
+    printEndLn();
+    printRow({"Draws", "Path", "Record, ms", "Record, ns/draw", "GPU, ms", "GPU, ns/draw"});
+    for (uint32_t drawCount : drawCounts)
+    {
+        for (ConstantsPath path : {
+            ConstantsPath::PushConstants,
+            ConstantsPath::DynamicUniformBuffer,
+            ConstantsPath::InlineUniformBlock})
+        {
+            if (ConstantsPath::InlineUniformBlock == path && !inlineUniformBlock)
+            {
+                printRow({std::to_string(drawCount), pathName(path), "Not supported"});
+                continue;
+            }
+            const ConstantsResult result = scene.run(path, drawCount);
+            const std::string metric = "draws=" + std::to_string(drawCount) + "/" + pathName(path);
+            recordResult(metric + "/record", result.record);
+            recordResult(metric + "/gpu", result.gpu);
+            printRow({
+                std::to_string(drawCount),
+                pathName(path),
+                fixedString(result.record.median, 2),
+                fixedString(result.record.median * 1e6 / drawCount, 1),
+                fixedString(result.gpu.median, 2),
+                fixedString(result.gpu.median * 1e6 / drawCount, 1)});
+        }
+    }
+}
@@ -0,0 +1,343 @@
+#include <random>
+#include "gpucaps.h"
+#include "benchmark.h"
+
+static const uint32_t setCount = 1024;
+static const uint32_t maxDescriptorsPerSet = 8;
+static const uint32_t maxBindlessDescriptorCount = 1 << 20;
+static const uint32_t sparseUpdateCount = 1024;
+static const uint32_t repeatCount = 10;
+
+static double millionsPerSecond(double count, double milliseconds) noexcept
+{
+    return milliseconds > 0. ? count / (milliseconds * 1e3) : 0.;
+}
+
+struct PoolResult
+{
+    Timing allocate;
+    Timing batchAllocate;
+    Timing reset;
+    Timing free;
+};
+
+static PoolResult benchmarkPoolAllocation(const DeviceContext& context, VkDescriptorSetLayout setLayout, uint32_t descriptorCount)
+{
+    const VkDevice device = context.getDevice();
+    const std::vector<VkDescriptorPoolSize> poolSizes = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorCount * setCount}};
+    DescriptorPool pool = context.createDescriptorPool(setCount, poolSizes);
+    DescriptorPool freeablePool = context.createDescriptorPool(setCount, poolSizes, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+    std::vector<VkDescriptorSet> descriptorSets(setCount);
+    const std::vector<VkDescriptorSetLayout> setLayouts(setCount, setLayout);
+    PoolResult result;
+    std::vector<double> allocateSamples, resetSamples;
+    for (uint32_t i = 0; i < repeatCount; ++i)
+    {   // One set per call, as allocated on demand
+        auto begin = Clock::now();
+        for (uint32_t j = 0; j < setCount; ++j)
+            descriptorSets[j] = context.allocateDescriptorSet(pool, setLayout);
+        allocateSamples.push_back(elapsedMilliseconds(begin, Clock::now()));
+        begin = Clock::now();
+        checkResult(vkResetDescriptorPool(device, pool, 0), "vkResetDescriptorPool");
+        resetSamples.push_back(elapsedMilliseconds(begin, Clock::now()));
+    }
+    result.allocate = summarize(std::move(allocateSamples));
+    result.reset = summarize(std::move(resetSamples));
+    result.batchAllocate = measure(repeatCount,
+        [&]()
+        {
+            VkDescriptorSetAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = pool;
+            allocInfo.descriptorSetCount = setCount;
+            allocInfo.pSetLayouts = setLayouts.data();
+            checkResult(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()), "vkAllocateDescriptorSets");
+            checkResult(vkResetDescriptorPool(device, pool, 0), "vkResetDescriptorPool");
+        });
+    result.free = measure(repeatCount,
+        [&]()
+        {
+            for (uint32_t j = 0; j < setCount; ++j)
+                descriptorSets[j] = context.allocateDescriptorSet(freeablePool, setLayout);
+            for (uint32_t j = 0; j < setCount; ++j)
+                checkResult(vkFreeDescriptorSets(device, freeablePool, 1, &descriptorSets[j]), "vkFreeDescriptorSets");
+        });
+    return result;
+}
+
+struct UpdateResult
+{
+    Timing batched;
+    Timing perSet;
+    Timing updateTemplate;
+    bool templateSupported = false;
+};
+
+static UpdateResult benchmarkUpdates(const DeviceContext& context, VkDescriptorSetLayout setLayout, uint32_t descriptorCount)
+{
+    const VkDevice device = context.getDevice();
+    DescriptorPool pool = context.createDescriptorPool(setCount, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorCount * setCount}});
+    std::vector<VkDescriptorSet> descriptorSets(setCount);
+    for (auto& descriptorSet : descriptorSets)
+        descriptorSet = context.allocateDescriptorSet(pool, setLayout);
+    Buffer buffer = context.createBuffer(descriptorCount * 256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    std::vector<VkDescriptorBufferInfo> bufferInfos(descriptorCount);
+    for (uint32_t i = 0; i < descriptorCount; ++i)
+        bufferInfos[i] = {buffer, i * 256, 256};
+    std::vector<VkWriteDescriptorSet> descriptorWrites(setCount);
+    for (uint32_t i = 0; i < setCount; ++i)
+    {
+        VkWriteDescriptorSet& descriptorWrite = descriptorWrites[i];
+        descriptorWrite = {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[i];
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.descriptorCount = descriptorCount;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrite.pBufferInfo = bufferInfos.data();
+    }
+    UpdateResult result;
+    result.batched = measure(repeatCount,
+        [&]()
+        {
+            vkUpdateDescriptorSets(device, setCount, descriptorWrites.data(), 0, nullptr);
+        });
+    result.perSet = measure(repeatCount,
+        [&]()
+        {
+            for (const auto& descriptorWrite : descriptorWrites)
+                vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+        });
+    auto createDescriptorUpdateTemplate = context.getProc<PFN_vkCreateDescriptorUpdateTemplate>("vkCreateDescriptorUpdateTemplate");
+    auto destroyDescriptorUpdateTemplate = context.getProc<PFN_vkDestroyDescriptorUpdateTemplate>("vkDestroyDescriptorUpdateTemplate");
+    auto updateDescriptorSetWithTemplate = context.getProc<PFN_vkUpdateDescriptorSetWithTemplate>("vkUpdateDescriptorSetWithTemplate");
+    if (createDescriptorUpdateTemplate && destroyDescriptorUpdateTemplate && updateDescriptorSetWithTemplate)
+    {
+        VkDescriptorUpdateTemplateEntry entry;
+        entry.dstBinding = 0;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = descriptorCount;
+        entry.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        entry.offset = 0;
+        entry.stride = sizeof(VkDescriptorBufferInfo);
+        VkDescriptorUpdateTemplateCreateInfo templateInfo = {};
+        templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        templateInfo.descriptorUpdateEntryCount = 1;
+        templateInfo.pDescriptorUpdateEntries = &entry;
+        templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        templateInfo.descriptorSetLayout = setLayout;
+        VkDescriptorUpdateTemplate updateTemplate;
+        checkResult(createDescriptorUpdateTemplate(device, &templateInfo, nullptr, &updateTemplate), "vkCreateDescriptorUpdateTemplate");
+        result.updateTemplate = measure(repeatCount,
+            [&]()
+            {
+                for (VkDescriptorSet descriptorSet : descriptorSets)
+                    updateDescriptorSetWithTemplate(device, descriptorSet, updateTemplate, bufferInfos.data());
+            });
+        destroyDescriptorUpdateTemplate(device, updateTemplate, nullptr);
+        result.templateSupported = true;
+    }
+    return result;
+}
+
+#ifdef VK_EXT_descriptor_indexing
+struct BindlessResult
+{
+    uint32_t descriptorCount;
+    Timing allocate;
+    Timing fullUpdate;
+    Timing sparseUpdate;
+};
+
+// Large update-after-bind array of sampled images, bound in command buffer while it is updated
+static BindlessResult benchmarkBindless(const DeviceContext& context, VkImageView imageView, uint32_t descriptorCount,
+    bool variableDescriptorCount, std::mt19937& rng)
+{
+    const VkDevice device = context.getDevice();
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    binding.descriptorCount = descriptorCount;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+    if (variableDescriptorCount)
+        bindingFlags |= VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+    DescriptorSetLayout setLayout = context.createDescriptorSetLayout({binding},
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT, &bindingFlagsInfo);
+    PipelineLayout pipelineLayout = context.createPipelineLayout({setLayout});
+    VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variableCountInfo = {};
+    variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+    variableCountInfo.descriptorSetCount = 1;
+    variableCountInfo.pDescriptorCounts = &descriptorCount;
+    BindlessResult result;
+    result.descriptorCount = descriptorCount;
+    DescriptorPool pool = context.createDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, descriptorCount}},
+        VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT);
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    result.allocate = measureSamples(repeatCount,
+        [&]()
+        {   // Set of previous sample is released outside of timed region
+            checkResult(vkResetDescriptorPool(device, pool, 0), "vkResetDescriptorPool");
+            const auto begin = Clock::now();
+            descriptorSet = context.allocateDescriptorSet(pool, setLayout, variableDescriptorCount ? &variableCountInfo : nullptr);
+            return elapsedMilliseconds(begin, Clock::now());
+        });
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
+    CommandPool commandPool = context.createCommandPool(queueFamilyIndex);
+    VkCommandBuffer commandBuffer = context.allocateCommandBuffer(commandPool);
+    beginCommandBuffer(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    const VkDescriptorImageInfo imageInfo = {VK_NULL_HANDLE, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    const std::vector<VkDescriptorImageInfo> imageInfos(descriptorCount, imageInfo);
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorCount = descriptorCount;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    descriptorWrite.pImageInfo = imageInfos.data();
+    result.fullUpdate = measure(repeatCount,
+        [&]()
+        {
+            vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+        });
+    // Streaming pattern: scattered single-element updates
+    std::uniform_int_distribution<uint32_t> distribution(0, descriptorCount - 1);
+    std::vector<VkWriteDescriptorSet> sparseWrites(sparseUpdateCount, descriptorWrite);
+    result.sparseUpdate = measure(repeatCount,
+        [&]()
+        {
+            for (auto& sparseWrite : sparseWrites)
+            {
+                sparseWrite.dstArrayElement = distribution(rng);
+                sparseWrite.descriptorCount = 1;
+                vkUpdateDescriptorSets(device, 1, &sparseWrite, 0, nullptr);
+            }
+        });
+    endCommandBuffer(commandBuffer);
+    return result;
+}
+#endif // VK_EXT_descriptor_indexing
+
+void benchmarkDescriptors(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    auto deviceExtensions = std::make_shared<magma::PhysicalDeviceExtensions>(physicalDevice);
+    DeviceOptions options;
+    for (const char *extensionName : {
+        VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+        VK_KHR_MAINTENANCE3_EXTENSION_NAME})
+    {
+        if (deviceExtensionSupported(physicalDevice->getHandle(), extensionName))
+            options.extensions.push_back(extensionName);
+    }
+    bool bindless = false;
+#ifdef VK_EXT_descriptor_indexing
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties = {};
+    if (deviceExtensions->EXT_descriptor_indexing)
+    {
+        const auto features = physicalDevice->getDescriptorIndexingFeatures();
+        descriptorIndexingProperties = physicalDevice->getDescriptorIndexingProperties();
+        bindless = features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingPartiallyBound;
+        if (bindless)
+        {   // Enable only what is measured
+            descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+            descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount = features.descriptorBindingVariableDescriptorCount;
+            descriptorIndexingFeatures.runtimeDescriptorArray = features.runtimeDescriptorArray;
+            options.extendedFeatures = &descriptorIndexingFeatures;
+            options.extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
+    }
+#endif // VK_EXT_descriptor_indexing
+    DeviceContext context(physicalDevice->getHandle(), options);
+    const VkPhysicalDeviceLimits& limits = context.getLimits();
+    const uint32_t descriptorCount = std::min(maxDescriptorsPerSet, limits.maxPerStageDescriptorStorageBuffers);
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = descriptorCount;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    DescriptorSetLayout setLayout = context.createDescriptorSetLayout({binding});
+    setFieldWidth(40);
+    printEndLn();
+    printLn("Max descriptor set storage buffers", uint32String(limits.maxDescriptorSetStorageBuffers));
+    printLn("Max descriptor set sampled images", uint32String(limits.maxDescriptorSetSampledImages));
+    printLn("Descriptor sets", setCount);
+    printLn("Storage buffers per set", descriptorCount);
+    const PoolResult poolResult = benchmarkPoolAllocation(context, setLayout, descriptorCount);
+    recordResult("pool/allocate", poolResult.allocate);
+    recordResult("pool/batched allocate and reset", poolResult.batchAllocate);
+    recordResult("pool/reset", poolResult.reset);
+    recordResult("pool/allocate and free", poolResult.free);
+    printEndLn();
+    std::cout << "Descriptor pool" << std::endl << std::endl;
+    printLn("Allocate, million sets/s", fixedString(millionsPerSecond(setCount, poolResult.allocate.median), 3));
+    printLn("Batched allocate and reset, million sets/s", fixedString(millionsPerSecond(setCount, poolResult.batchAllocate.median), 3));
+    printLn("Reset, us", fixedString(poolResult.reset.median * 1e3, 2));
+    printLn("Allocate and free, million sets/s", fixedString(millionsPerSecond(setCount, poolResult.free.median), 3));
+    const UpdateResult updateResult = benchmarkUpdates(context, setLayout, descriptorCount);
+    const double updatedDescriptors = static_cast<double>(setCount) * descriptorCount;
+    recordResult("update/batched", updateResult.batched);
+    recordResult("update/per set", updateResult.perSet);
+    if (updateResult.templateSupported)
+        recordResult("update/template per set", updateResult.updateTemplate);
+    printEndLn();
+    std::cout << "Descriptor updates, million descriptors/s" << std::endl << std::endl;
+    printLn("vkUpdateDescriptorSets batched", fixedString(millionsPerSecond(updatedDescriptors, updateResult.batched.median), 2));
+    printLn("vkUpdateDescriptorSets per set", fixedString(millionsPerSecond(updatedDescriptors, updateResult.perSet.median), 2));
+    if (updateResult.templateSupported)
+        printLn("Update template per set", fixedString(millionsPerSecond(updatedDescriptors, updateResult.updateTemplate.median), 2));
+    else
+        printLn("Update template per set", "Not supported");
+    printEndLn();
+    std::cout << "Update-after-bind sampled image array" << std::endl << std::endl;
+#ifdef VK_EXT_descriptor_indexing
+    if (bindless)
+    {
+        const uint32_t maxDescriptorCount = std::min({
+            descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+            descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            descriptorIndexingProperties.maxPerStageUpdateAfterBindResources,
+            descriptorIndexingProperties.maxUpdateAfterBindDescriptorsInAllPools,
+            maxBindlessDescriptorCount});
+        printLn("Max descriptor set update after bind sampled images", uint32String(descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages));
+        printLn("Max update after bind descriptors in all pools", uint32String(descriptorIndexingProperties.maxUpdateAfterBindDescriptorsInAllPools));
+        printLn("Variable descriptor count", booleanString(descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount));
+        printEndLn();
+        Image image = context.createImage(VK_FORMAT_R8G8B8A8_UNORM, 4, 4, VK_IMAGE_USAGE_SAMPLED_BIT);
+        std::mt19937 rng(0);
+        std::vector<uint32_t> arraySizes;
+        for (uint32_t arraySize = 1024; arraySize < maxDescriptorCount; arraySize *= 4)
+            arraySizes.push_back(arraySize);
+        arraySizes.push_back(maxDescriptorCount);
+        printRow({"Descriptors", "Allocate, ms", "Full update", "Scattered update"}, 18);
+        printRow({"", "", "Mdesc/s", "us/descriptor"}, 18);
+        for (uint32_t arraySize : arraySizes)
+        {
+            const BindlessResult result = benchmarkBindless(context, image.view, arraySize,
+                descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount != VK_FALSE, rng);
+            const std::string path = "bindless/descriptors=" + std::to_string(result.descriptorCount) + "/";
+            recordResult(path + "allocate", result.allocate);
+            recordResult(path + "full update", result.fullUpdate);
+            recordResult(path + "scattered update", result.sparseUpdate);
+            printRow({
+                std::to_string(result.descriptorCount),
+                fixedString(result.allocate.median, 3),
+                fixedString(millionsPerSecond(result.descriptorCount, result.fullUpdate.median), 2),
+                fixedString(result.sparseUpdate.median * 1e3 / sparseUpdateCount, 3)}, 18);
+        }
+    }
+    else
+#endif // VK_EXT_descriptor_indexing
+    {
+        std::cout << "Not supported" << std::endl;
+    }
+}
@@ -0,0 +1,199 @@
+#include "gpucaps.h"
+#include "benchmark.h"
+
+static const VkDeviceSize latencyCopySize = 256;
+static const VkDeviceSize bandwidthCopySize = 64 * 1024 * 1024;
+static const uint32_t repeatCount = 20;
+
+struct TransferResult
+{
+    Timing latency;
+    Timing bandwidth;
+};
+
+static VkCommandBuffer recordCopy(const DeviceContext& context, VkCommandPool commandPool,
+    VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, uint32_t deviceMask)
+{
+    VkCommandBuffer commandBuffer = context.allocateCommandBuffer(commandPool);
+    VkDeviceGroupCommandBufferBeginInfo deviceGroupBeginInfo = {};
+    deviceGroupBeginInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO;
+    deviceGroupBeginInfo.deviceMask = deviceMask;
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = &deviceGroupBeginInfo;
+    checkResult(vkBeginCommandBuffer(commandBuffer, &beginInfo), "vkBeginCommandBuffer");
+    VkBufferCopy region = {0, 0, size};
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &region);
+    checkResult(vkEndCommandBuffer(commandBuffer), "vkEndCommandBuffer");
+    return commandBuffer;
+}
+
+static double submitToDevice(const DeviceContext& context, VkQueue queue, VkCommandBuffer commandBuffer,
+    VkFence fence, uint32_t deviceMask)
+{
+    VkDeviceGroupSubmitInfo deviceGroupSubmitInfo = {};
+    deviceGroupSubmitInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO;
+    deviceGroupSubmitInfo.commandBufferCount = 1;
+    deviceGroupSubmitInfo.pCommandBufferDeviceMasks = &deviceMask;
+    return context.submitAndWait(queue, commandBuffer, fence, &deviceGroupSubmitInfo);
+}
+
+// Binds buffer on every device of the group to memory instance of <memoryDeviceIndex>
+static BufferHandle createPeerBuffer(const DeviceContext& context, VkDeviceMemory memory,
+    VkDeviceSize size, uint32_t memoryDeviceIndex)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer buffer;
+    checkResult(vkCreateBuffer(context.getDevice(), &bufferInfo, nullptr, &buffer), "vkCreateBuffer");
+    BufferHandle peerBuffer(context.getDevice(), buffer);
+    const std::vector<uint32_t> deviceIndices(context.getDeviceCount(), memoryDeviceIndex);
+    VkBindBufferMemoryDeviceGroupInfo deviceGroupBindInfo = {};
+    deviceGroupBindInfo.sType = VK_STRUCTURE_TYPE_BIND_BUFFER_MEMORY_DEVICE_GROUP_INFO;
+    deviceGroupBindInfo.deviceIndexCount = context.getDeviceCount();
+    deviceGroupBindInfo.pDeviceIndices = deviceIndices.data();
+    VkBindBufferMemoryInfo bindInfo = {};
+    bindInfo.sType = VK_STRUCTURE_TYPE_BIND_BUFFER_MEMORY_INFO;
+    bindInfo.pNext = &deviceGroupBindInfo;
+    bindInfo.buffer = peerBuffer;
+    bindInfo.memory = memory;
+    bindInfo.memoryOffset = 0;
+    auto bindBufferMemory2 = context.getProc<PFN_vkBindBufferMemory2>("vkBindBufferMemory2");
+    if (!bindBufferMemory2)
+        throw BenchmarkSkipped("vkBindBufferMemory2 not available");
+    checkResult(bindBufferMemory2(context.getDevice(), 1, &bindInfo), "vkBindBufferMemory2");
+    return peerBuffer;
+}
+
+static uint32_t findMultiInstanceMemoryType(const DeviceContext& context)
+{
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = context.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        const VkMemoryType& memoryType = memoryProperties.memoryTypes[i];
+        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+            (memoryProperties.memoryHeaps[memoryType.heapIndex].flags & VK_MEMORY_HEAP_MULTI_INSTANCE_BIT))
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+static void printTransfer(const char *description, const TransferResult& result, VkDeviceSize size,
+    const std::string& metric)
+{
+    recordResult(metric + " latency", result.latency);
+    recordResult(metric + " bandwidth", result.bandwidth);
+    printLn(description, fixedString(result.latency.median * 1000., 1) + " us, " +
+        fixedString(gigabytesPerSecond(size, result.bandwidth.median), 2) + " GB/s");
+}
+
+void benchmarkDeviceGroup(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    auto instanceExtensions = std::make_unique<magma::InstanceExtensions>();
+    if (!instanceExtensions->KHR_device_group_creation)
+        throw BenchmarkSkipped("VK_KHR_device_group_creation not supported");
+    // Benchmark every group once, with its first physical device
+    const auto physicalDeviceGroups = instance->enumeratePhysicalDeviceGroups();
+    auto group = std::find_if(physicalDeviceGroups.begin(), physicalDeviceGroups.end(),
+        [physicalDevice](const auto& group)
+        {
+            return group.physicalDevices[0] == physicalDevice->getHandle();
+        });
+    if (group == physicalDeviceGroups.end())
+        throw BenchmarkSkipped("not the first physical device of its group");
+    if (group->physicalDeviceCount < 2)
+        throw BenchmarkSkipped("device group has single physical device");
+    DeviceOptions options;
+    options.deviceGroup.assign(group->physicalDevices, group->physicalDevices + group->physicalDeviceCount);
+    for (const char *extensionName : {
+        VK_KHR_DEVICE_GROUP_EXTENSION_NAME,
+        VK_KHR_BIND_MEMORY_2_EXTENSION_NAME})
+    {
+        if (deviceExtensionSupported(physicalDevice->getHandle(), extensionName))
+            options.extensions.push_back(extensionName);
+    }
+    DeviceContext context(physicalDevice->getHandle(), options);
+    const uint32_t deviceCount = context.getDeviceCount();
+    const uint32_t memoryTypeIndex = findMultiInstanceMemoryType(context);
+    if (UINT32_MAX == memoryTypeIndex)
+        throw BenchmarkSkipped("no device local memory in multi-instance heap");
+    const uint32_t heapIndex = context.getMemoryProperties().memoryTypes[memoryTypeIndex].heapIndex;
+    auto getDeviceGroupPeerMemoryFeatures = context.getProc<PFN_vkGetDeviceGroupPeerMemoryFeatures>("vkGetDeviceGroupPeerMemoryFeatures");
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_TRANSFER_BIT);
+    const VkQueue queue = context.getQueue(queueFamilyIndex);
+    CommandPool commandPool = context.createCommandPool(queueFamilyIndex);
+    Fence fence = context.createFence();
+    // Allocate instance of memory on every device of the group
+    VkMemoryAllocateFlagsInfo allocateFlagsInfo = {};
+    allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_MASK_BIT;
+    allocateFlagsInfo.deviceMask = (1u << deviceCount) - 1;
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    Buffer srcBuffer = context.createBuffer(bandwidthCopySize, usage, memoryTypeIndex, &allocateFlagsInfo);
+    Buffer dstBuffer = context.createBuffer(bandwidthCopySize, usage, memoryTypeIndex, &allocateFlagsInfo);
+    Buffer stagingBuffer = context.createBuffer(bandwidthCopySize, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::vector<BufferHandle> peerBuffers;
+    for (uint32_t i = 0; i < deviceCount; ++i)
+        peerBuffers.push_back(createPeerBuffer(context, srcBuffer.memory, bandwidthCopySize, i));
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Heap index", heapIndex);
+    printLn("Latency copy size", latencyCopySize);
+    printLn("Bandwidth copy size", bandwidthCopySize);
+    for (uint32_t src = 0; src < deviceCount; ++src)
+    {
+        for (uint32_t dst = 0; dst < deviceCount; ++dst)
+        {
+            if (src == dst)
+                continue;
+            printEndLn();
+            std::cout << "#" << src << " -> #" << dst << std::endl << std::endl;
+            const std::string path = std::to_string(src) + "->" + std::to_string(dst) + "/";
+            const uint32_t srcMask = 1u << src;
+            const uint32_t dstMask = 1u << dst;
+            VkPeerMemoryFeatureFlags peerMemoryFeatures = 0;
+            if (getDeviceGroupPeerMemoryFeatures)
+                getDeviceGroupPeerMemoryFeatures(context.getDevice(), heapIndex, dst, src, &peerMemoryFeatures);
+            TransferResult staged;
+            for (VkDeviceSize size : {latencyCopySize, bandwidthCopySize})
+            {   // Source device copies to host memory, then destination device copies from it
+                VkCommandBuffer download = recordCopy(context, commandPool, srcBuffer, stagingBuffer, size, srcMask);
+                VkCommandBuffer upload = recordCopy(context, commandPool, stagingBuffer, dstBuffer, size, dstMask);
+                const Timing timing = measureSamples(repeatCount,
+                    [&]()
+                    {
+                        return submitToDevice(context, queue, download, fence, srcMask) +
+                            submitToDevice(context, queue, upload, fence, dstMask);
+                    });
+                (size == latencyCopySize ? staged.latency : staged.bandwidth) = timing;
+            }
+            if (peerMemoryFeatures & VK_PEER_MEMORY_FEATURE_COPY_SRC_BIT)
+            {
+                TransferResult peer;
+                for (VkDeviceSize size : {latencyCopySize, bandwidthCopySize})
+                {   // Destination device reads directly from memory instance of source device
+                    VkCommandBuffer copy = recordCopy(context, commandPool, peerBuffers[src], dstBuffer, size, dstMask);
+                    const Timing timing = measureSamples(repeatCount,
+                        [&]()
+                        {
+                            return submitToDevice(context, queue, copy, fence, dstMask);
+                        });
+                    (size == latencyCopySize ? peer.latency : peer.bandwidth) = timing;
+                }
+                printTransfer("Peer copy", peer, bandwidthCopySize, path + "peer copy");
+                printTransfer("Staged copy", staged, bandwidthCopySize, path + "staged copy");
+                printLn("Peer bandwidth speedup", fixedString(staged.bandwidth.median / peer.bandwidth.median, 2) + "x");
+            }
+            else
+            {
+                printLn("Peer copy", "Not supported");
+                printTransfer("Staged copy", staged, bandwidthCopySize, path + "staged copy");
+            }
+            checkResult(vkResetCommandPool(context.getDevice(), commandPool, 0), "vkResetCommandPool");
+        }
+    }
+}
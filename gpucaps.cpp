@@ -1,5 +1,5 @@
 #include "gpucaps.h"
-#include "third-party/magma/magma.h"
+#include "benchmark.h"
 
 // https://www.reddit.com/r/vulkan/comments/4ta9nj/is_there_a_comprehensive_list_of_the_names_and/
 enum VendorId : uint16_t
@@ -70,6 +70,78 @@ std::string vendorName(uint32_t vendorID)
     return "Unknown";
 }
 
+std::string peerMemoryFeaturesString(VkPeerMemoryFeatureFlags peerMemoryFeatures)
+{
+    std::string features;
+    for (const auto bit : {
+        VK_PEER_MEMORY_FEATURE_COPY_SRC_BIT,
+        VK_PEER_MEMORY_FEATURE_COPY_DST_BIT,
+        VK_PEER_MEMORY_FEATURE_GENERIC_SRC_BIT,
+        VK_PEER_MEMORY_FEATURE_GENERIC_DST_BIT})
+    {
+        if (peerMemoryFeatures & bit)
+        {
+            if (!features.empty())
+                features += " | ";
+            switch (bit)
+            {
+            case VK_PEER_MEMORY_FEATURE_COPY_SRC_BIT: features += "COPY_SRC"; break;
+            case VK_PEER_MEMORY_FEATURE_COPY_DST_BIT: features += "COPY_DST"; break;
+            case VK_PEER_MEMORY_FEATURE_GENERIC_SRC_BIT: features += "GENERIC_SRC"; break;
+            case VK_PEER_MEMORY_FEATURE_GENERIC_DST_BIT: features += "GENERIC_DST"; break;
+            default: break;
+            }
+        }
+    }
+    return features.empty() ? "---" : features;
+}
+
+void printPeerMemoryFeatures(const VkPhysicalDeviceGroupProperties& physicalDeviceGroup)
+{
+    DeviceOptions options;
+    options.deviceGroup.assign(physicalDeviceGroup.physicalDevices,
+        physicalDeviceGroup.physicalDevices + physicalDeviceGroup.physicalDeviceCount);
+    if (deviceExtensionSupported(physicalDeviceGroup.physicalDevices[0], VK_KHR_DEVICE_GROUP_EXTENSION_NAME))
+        options.extensions.push_back(VK_KHR_DEVICE_GROUP_EXTENSION_NAME);
+    std::cout << "Peer memory features";
+    try
+    {
+        DeviceContext context(physicalDeviceGroup.physicalDevices[0], options);
+        auto getDeviceGroupPeerMemoryFeatures = context.getProc<PFN_vkGetDeviceGroupPeerMemoryFeatures>("vkGetDeviceGroupPeerMemoryFeatures");
+        if (!getDeviceGroupPeerMemoryFeatures)
+        {
+            printEndLn();
+            std::cout << '\t' << "Not supported";
+        }
+        else
+        {
+            const VkPhysicalDeviceMemoryProperties& memoryProperties = context.getMemoryProperties();
+            for (uint32_t heapIndex = 0; heapIndex < memoryProperties.memoryHeapCount; ++heapIndex)
+            {
+                for (uint32_t local = 0; local < physicalDeviceGroup.physicalDeviceCount; ++local)
+                {
+                    for (uint32_t remote = 0; remote < physicalDeviceGroup.physicalDeviceCount; ++remote)
+                    {
+                        if (local == remote)
+                            continue;
+                        VkPeerMemoryFeatureFlags peerMemoryFeatures = 0;
+                        getDeviceGroupPeerMemoryFeatures(context.getDevice(), heapIndex, local, remote, &peerMemoryFeatures);
+                        printEndLn();
+                        std::cout << '\t' << "Heap " << heapIndex << ", local #" << local << ", remote #" << remote
+                            << ": " << peerMemoryFeaturesString(peerMemoryFeatures);
+                    }
+                }
+            }
+        }
+    }
+    catch (const std::exception& exc)
+    {
+        printEndLn();
+        std::cout << '\t' << exc.what();
+    }
+    printEndLn();
+}
+
 void printDeviceGroups(magma::InstancePtr instance)
 {
     const auto physicalDeviceGroups = instance->enumeratePhysicalDeviceGroups();
@@ -80,6 +152,8 @@ void printDeviceGroups(magma::InstancePtr instance)
         std::cout << "#" << physicalGroupIndex++ << std::endl << std::endl;
         printLn("Physical device count ", physicalDeviceGroup.physicalDeviceCount);
         printLn("Subset allocation", booleanString(physicalDeviceGroup.subsetAllocation));
+        if (physicalDeviceGroup.physicalDeviceCount > 1)
+            printPeerMemoryFeatures(physicalDeviceGroup);
         printEndLn();
     }
 }
@@ -325,17 +399,17 @@ void printDeviceLimits(magma::PhysicalDevicePtr physicalDevice)
     printLn("Max framebuffer width", limits.maxFramebufferWidth);
     printLn("Max framebuffer height", limits.maxFramebufferHeight);
     printLn("Max framebuffer layers", limits.maxFramebufferLayers);
-    printLn("Framebuffer color sample counts", limits.framebufferColorSampleCounts);
-    printLn("Framebuffer depth sample counts", limits.framebufferDepthSampleCounts);
-    printLn("Framebuffer stencil sample counts", limits.framebufferStencilSampleCounts);
-    printLn("Framebuffer no attachments sample counts", limits.framebufferNoAttachmentsSampleCounts);
+    printLn("Framebuffer color sample counts", sampleCountsString(limits.framebufferColorSampleCounts));
+    printLn("Framebuffer depth sample counts", sampleCountsString(limits.framebufferDepthSampleCounts));
+    printLn("Framebuffer stencil sample counts", sampleCountsString(limits.framebufferStencilSampleCounts));
+    printLn("Framebuffer no attachments sample counts", sampleCountsString(limits.framebufferNoAttachmentsSampleCounts));
     printLn("Max color attachments", limits.maxColorAttachments);
     printEndLn();
-    printLn("Sampled image color sample counts", limits.sampledImageColorSampleCounts);
-    printLn("Sampled image integer sample counts", limits.sampledImageIntegerSampleCounts);
-    printLn("Sampled image depth sample counts", limits.sampledImageDepthSampleCounts);
-    printLn("Sampled image stencil sample counts", limits.sampledImageStencilSampleCounts);
-    printLn("Storage image sample counts", limits.storageImageSampleCounts);
+    printLn("Sampled image color sample counts", sampleCountsString(limits.sampledImageColorSampleCounts));
+    printLn("Sampled image integer sample counts", sampleCountsString(limits.sampledImageIntegerSampleCounts));
+    printLn("Sampled image depth sample counts", sampleCountsString(limits.sampledImageDepthSampleCounts));
+    printLn("Sampled image stencil sample counts", sampleCountsString(limits.sampledImageStencilSampleCounts));
+    printLn("Storage image sample counts", sampleCountsString(limits.storageImageSampleCounts));
     printLn("Max sample mask words", limits.maxSampleMaskWords);
     printEndLn();
     printLn("Timestamp compute and graphics", booleanString(limits.timestampComputeAndGraphics));
@@ -462,6 +536,67 @@ void printDeviceMemoryHeaps(magma::PhysicalDevicePtr physicalDevice)
     }
 }
 
+bool getSubgroupProperties(VkInstance instance, VkPhysicalDevice physicalDevice,
+    VkPhysicalDeviceSubgroupProperties& subgroupProperties)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (enumerateInstanceVersion() < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1)
+        return false;
+    auto getPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+    if (!getPhysicalDeviceProperties2)
+        return false;
+    subgroupProperties = {};
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2 = {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroupProperties;
+    getPhysicalDeviceProperties2(physicalDevice, &properties2);
+    return true;
+}
+
+void printSubgroupProperties(const VkPhysicalDeviceSubgroupProperties& properties)
+{
+    printEndLn();
+    printLn("Subgroup size", properties.subgroupSize);
+    std::cout << "Supported stages";
+    for (const auto bit : {
+        VK_SHADER_STAGE_VERTEX_BIT,
+        VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+        VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+        VK_SHADER_STAGE_GEOMETRY_BIT,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        VK_SHADER_STAGE_COMPUTE_BIT})
+    {
+        if (properties.supportedStages & bit)
+        {
+            printEndLn();
+            std::cout << '\t' << magma::helpers::stringize(bit);
+        }
+    }
+    printEndLn();
+    std::cout << "Supported operations";
+    for (const auto bit : {
+        VK_SUBGROUP_FEATURE_BASIC_BIT,
+        VK_SUBGROUP_FEATURE_VOTE_BIT,
+        VK_SUBGROUP_FEATURE_ARITHMETIC_BIT,
+        VK_SUBGROUP_FEATURE_BALLOT_BIT,
+        VK_SUBGROUP_FEATURE_SHUFFLE_BIT,
+        VK_SUBGROUP_FEATURE_SHUFFLE_RELATIVE_BIT,
+        VK_SUBGROUP_FEATURE_CLUSTERED_BIT,
+        VK_SUBGROUP_FEATURE_QUAD_BIT})
+    {
+        if (properties.supportedOperations & bit)
+        {
+            printEndLn();
+            std::cout << '\t' << magma::helpers::stringize(bit);
+        }
+    }
+    printEndLn();
+    printLn("Quad operations in all stages", booleanString(properties.quadOperationsInAllStages));
+}
+
 void print8BitStorageProperties(magma::PhysicalDevicePtr physicalDevice)
 {
     MAGMA_UNUSED(physicalDevice);
@@ -824,19 +959,120 @@ magma::InstancePtr createInstance(std::shared_ptr<magma::InstanceLayers> instanc
         extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
     if (instanceExtensions->KHR_device_group_creation)
         extensions.push_back(VK_KHR_DEVICE_GROUP_CREATION_EXTENSION_NAME);
-    magma::Application applicationInfo("gpucaps", 1, "magma", 1, VK_API_VERSION_1_0);
+    // Vulkan 1.0 loader fails with any other version
+    magma::Application applicationInfo("gpucaps", 1, "magma", 1, enumerateInstanceVersion());
     return std::make_shared<magma::Instance>(layerNames, extensions, nullptr, &applicationInfo);
 }
 
-int main()
+void printUsage()
+{
+    std::cout << std::endl << "Usage: gpucaps [options]" << std::endl;
+    setFieldWidth(30);
+    printLn("--bench [<name>|all]", "Run benchmark; list benchmarks if name is omitted");
+    printLn("--threads <count>", "Limit threads of multithreaded benchmarks");
+    printLn("--commands <count>", "Commands per command buffer");
+    printLn("--calibration-file <path>", "Append timestamp calibration records to file");
+    printLn("--pin-cpu <index>", "Pin benchmark thread to logical CPU");
+    printLn("--results-file <path>", "Append benchmark results to file");
+    printLn("--compare-baseline", "Compare results with prior runs");
+    printLn("--baseline-driver <version>", "Compare with prior runs of this driver");
+    printLn("--adaptive", "Repeat measurements until confidence interval is narrow");
+}
+
+// Returns false unless whole string is unsigned 32-bit number
+bool parseUint32(const char *str, uint32_t& value)
+{
+    try
+    {
+        std::size_t length = 0;
+        const unsigned long number = std::stoul(str, &length);
+        if (str[0] == '-' || str[length] != '\0' || number > UINT32_MAX)
+            return false;
+        value = static_cast<uint32_t>(number);
+        return true;
+    }
+    catch (const std::logic_error&)
+    {   // std::invalid_argument or std::out_of_range
+        return false;
+    }
+}
+
+bool parseInt(const char *str, int& value)
+{
+    try
+    {
+        std::size_t length = 0;
+        const int number = std::stoi(str, &length);
+        if (str[length] != '\0')
+            return false;
+        value = number;
+        return true;
+    }
+    catch (const std::logic_error&)
+    {
+        return false;
+    }
+}
+
+int main(int argc, char *argv[])
 {
     std::cout << "Vulkan GPU Caps Viewer [Version 1.1]" << std::endl;
     std::cout << "(c) 2018-2021 Victor Coda." << std::endl;
 
+    const char *benchmarkName = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--bench"))
+        {
+            if (i + 1 >= argc)
+            {
+                listBenchmarks();
+                return 0;
+            }
+            benchmarkName = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--compare-baseline"))
+            benchmarkOptions.compareBaseline = true;
+        else if (!strcmp(argv[i], "--adaptive"))
+            measurementPolicy.adaptive = true;
+        else
+        {   // Other options take value
+            const char *option = argv[i];
+            const char *value = (i + 1 < argc) ? argv[++i] : nullptr;
+            bool valid = (value != nullptr);
+            if (!strcmp(option, "--threads"))
+                valid = valid && parseUint32(value, benchmarkOptions.maxThreadCount);
+            else if (!strcmp(option, "--commands"))
+                valid = valid && parseUint32(value, benchmarkOptions.commandCount);
+            else if (!strcmp(option, "--calibration-file") && valid)
+                benchmarkOptions.calibrationFile = value;
+            else if (!strcmp(option, "--pin-cpu"))
+                valid = valid && parseInt(value, benchmarkOptions.pinnedCpu);
+            else if (!strcmp(option, "--results-file") && valid)
+                benchmarkOptions.resultsFile = value;
+            else if (!strcmp(option, "--baseline-driver") && valid)
+            {
+                benchmarkOptions.baselineDriver = value;
+                benchmarkOptions.compareBaseline = true;
+            }
+            else
+                valid = false;
+            if (!valid)
+            {
+                std::cout << "Invalid option: " << option << (value ? std::string(" ") + value : "") << std::endl;
+                printUsage();
+                return -1;
+            }
+        }
+    }
+    if (benchmarkOptions.compareBaseline && !benchmarkName)
+        benchmarkName = "all";
     auto instanceLayers = std::make_shared<magma::InstanceLayers>();
     auto instance = createInstance(instanceLayers);
     if (!instance)
         return -1;
+    if (benchmarkName)
+        return runBenchmarks(instance, benchmarkName);
     auto instanceExtensions = std::make_shared<magma::InstanceExtensions>();
     printHeading("Instance Extensions");
     setFieldWidth(45);
@@ -876,6 +1112,13 @@ int main()
         printDeviceMemoryTypes(physicalDevice);
         printHeading("Device Memory Heaps");
         printDeviceMemoryHeaps(physicalDevice);
+        VkPhysicalDeviceSubgroupProperties subgroupProperties;
+        if (getSubgroupProperties(instance->getHandle(), physicalDevice->getHandle(), subgroupProperties))
+        {
+            printHeading("Subgroup");
+            setFieldWidth(35);
+            printSubgroupProperties(subgroupProperties);
+        }
         if (deviceExtensions->KHR_8bit_storage)
         {
             printHeading("8-bit Storage");
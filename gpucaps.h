@@ -1,5 +1,6 @@
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <cstring>
 #include <climits>
@@ -19,6 +20,13 @@ inline std::string booleanString(Bool value)
     return value ? "Yes" : "No";
 }
 
+inline std::string fixedString(double value, int precision)
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(precision) << value;
+    return oss.str();
+}
+
 inline void setFieldWidth(std::streamsize fieldWidth)
 {
     width = fieldWidth;
@@ -0,0 +1,289 @@
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstdio>
+#include "gpucaps.h"
+#include "statistics.h"
+#include "columnstore.h"
+
+static void printUsage()
+{
+    std::cout << "Usage:" << std::endl
+        << "  gpucaps-index <index> ingest <snapshot>... (- reads snapshot file names from stdin)" << std::endl
+        << "  gpucaps-index <index> query [<filter>] [--group-by <column>]" << std::endl
+        << "  gpucaps-index <index> columns" << std::endl
+        << "  gpucaps-index bench [<snapshot count>]" << std::endl;
+}
+
+static void loadIfExists(ColumnStore& store, const std::string& indexFileName)
+{
+    if (std::ifstream(indexFileName))
+        store.load(indexFileName);
+}
+
+static int ingest(const std::string& indexFileName, const std::vector<std::string>& snapshotFileNames)
+{
+    ColumnStore store;
+    loadIfExists(store, indexFileName);
+    uint32_t snapshotCount = 0, deviceCount = 0;
+    auto ingestFile = [&](const std::string& fileName)
+    {
+        std::ifstream snapshot(fileName);
+        if (!snapshot)
+        {
+            std::cout << "Failed to open " << fileName << std::endl;
+            return;
+        }
+        deviceCount += store.ingest(snapshot);
+        ++snapshotCount;
+    };
+    const auto begin = Clock::now();
+    for (const auto& fileName : snapshotFileNames)
+    {
+        if ("-" == fileName)
+        {
+            std::string line;
+            while (std::getline(std::cin, line))
+                ingestFile(line);
+        }
+        else
+            ingestFile(fileName);
+    }
+    store.save(indexFileName);
+    setFieldWidth(20);
+    printLn("Snapshots", snapshotCount);
+    printLn("Devices", deviceCount);
+    printLn("Total devices", store.getRowCount());
+    printLn("Columns", store.getColumns().size());
+    printLn("Time, ms", fixedString(elapsedMilliseconds(begin, Clock::now()), 1));
+    return 0;
+}
+
+static int query(const std::string& indexFileName, const std::string& expression, const std::string& groupColumn)
+{
+    ColumnStore store;
+    store.load(indexFileName);
+    const auto begin = Clock::now();
+    const Bitmap selection = filter(store, expression);
+    const uint64_t count = countRows(selection);
+    std::vector<Group> groups;
+    if (!groupColumn.empty())
+        groups = groupBy(store, selection, groupColumn);
+    const double milliseconds = elapsedMilliseconds(begin, Clock::now());
+    std::cout << count << " of " << store.getRowCount() << " devices" << std::endl;
+    if (!groups.empty())
+    {
+        printEndLn();
+        setFieldWidth(50);
+        for (const auto& group : groups)
+            printLn(group.value.c_str(), group.count);
+    }
+    printEndLn();
+    std::cout << "Query time " << fixedString(milliseconds, 3) << " ms" << std::endl;
+    return 0;
+}
+
+static const char *columnTypeString(ColumnStore::Type type)
+{
+    switch (type)
+    {
+    case ColumnStore::Type::Boolean: return "boolean";
+    case ColumnStore::Type::Number: return "number";
+    case ColumnStore::Type::String: return "string";
+    }
+    return "";
+}
+
+static int listColumns(const std::string& indexFileName)
+{
+    ColumnStore store;
+    store.load(indexFileName);
+    setFieldWidth(80);
+    for (const auto& column : store.getColumns())
+        printLn(column.name.c_str(), columnTypeString(column.type));
+    return 0;
+}
+
+// Snapshot text of random device in the same format as gpucaps output
+static std::string syntheticSnapshot(std::mt19937& rng)
+{
+    static const char *deviceNames[] = {
+        "NVIDIA GeForce RTX 3080", "NVIDIA GeForce GTX 1060", "AMD Radeon RX 6800", "AMD Radeon RX 580",
+        "Intel(R) UHD Graphics 630", "Intel(R) Iris(R) Xe Graphics", "Apple M1", "Mali-G78", "Adreno (TM) 660"};
+    static const char *features[] = {
+        "Robust buffer access", "Full draw index uint32", "Image cube array", "Independent blend",
+        "Geometry shader", "Tessellation shader", "Sample rate shading", "Dual src blend", "Logic op",
+        "Multi draw indirect", "Draw indirect first instance", "Depth clamp", "Depth bias clamp",
+        "Fill mode non-solid", "Depth bounds", "Wide lines", "Large points", "Alpha to one",
+        "Multi viewport", "Sampler anisotropy", "Texture compression ETC2", "Texture compression ASTC LDR",
+        "Texture compression BC", "Occlusion query precise", "Pipeline statistics query",
+        "Shader float64", "Shader int64", "Shader int16", "Sparse binding", "Variable multisample rate"};
+    static const char *descriptorIndexingFeatures[] = {
+        "Descriptor binding partially bound", "Descriptor binding variable descriptor count",
+        "Descriptor binding update unused while pending", "Runtime descriptor array"};
+    static const std::pair<const char *, uint32_t> limits[] = {
+        {"Max image dimension 1D", 16384}, {"Max image dimension 2D", 16384}, {"Max image dimension 3D", 2048},
+        {"Max image array layers", 2048}, {"Max push constants size", 256}, {"Max bound descriptor sets", 8},
+        {"Max per stage descriptor samplers", 1048576}, {"Max per stage resources", 4294967295u},
+        {"Max compute shared memory size", 49152}, {"Max compute work group invocations", 1024},
+        {"Max framebuffer width", 16384}, {"Max framebuffer height", 16384}, {"Max color attachments", 8},
+        {"Max sampler anisotropy", 16}, {"Max viewports", 16}, {"Min uniform buffer offset alignment", 64},
+        {"Min storage buffer offset alignment", 16}, {"Max draw indirect count", 4294967295u}};
+    static const char *extensions[] = {
+        "VK_KHR_swapchain", "VK_KHR_maintenance1", "VK_KHR_maintenance2", "VK_KHR_maintenance3",
+        "VK_KHR_driver_properties", "VK_KHR_8bit_storage", "VK_KHR_16bit_storage", "VK_KHR_timeline_semaphore",
+        "VK_KHR_buffer_device_address", "VK_KHR_ray_query", "VK_KHR_ray_tracing_pipeline",
+        "VK_KHR_acceleration_structure", "VK_EXT_descriptor_indexing", "VK_EXT_mesh_shader",
+        "VK_NV_mesh_shader", "VK_EXT_conservative_rasterization", "VK_EXT_line_rasterization",
+        "VK_EXT_calibrated_timestamps", "VK_EXT_inline_uniform_block", "VK_EXT_transform_feedback",
+        "VK_EXT_conditional_rendering", "VK_AMD_shader_core_properties", "VK_NV_shader_sm_builtins"};
+    const uint32_t deviceIndex = rng() % (sizeof(deviceNames)/sizeof(deviceNames[0]));
+    // Same device model has mostly the same capabilities
+    std::mt19937 deviceRng(deviceIndex);
+    std::ostringstream text;
+    auto heading = [&](const char *title)
+    {
+        text << std::endl << "======= " << title << " =======" << std::endl << std::endl;
+    };
+    auto line = [&](const std::string& key, const std::string& value)
+    {
+        text << std::setw(45) << std::left << key << value << std::endl;
+    };
+    text << "Vulkan GPU Caps Viewer [Version 1.1]" << std::endl;
+    heading("Instance Extensions");
+    line("Name", "Specification");
+    line("VK_KHR_surface", "25");
+    line("VK_KHR_get_physical_device_properties2", "2");
+    heading((std::string(deviceNames[deviceIndex]) + " (0)").c_str());
+    line("API version", "1.2." + std::to_string(130 + rng() % 70));
+    line("Driver version", std::to_string(400 + rng() % 100) + "." + std::to_string(rng() % 100));
+    line("Device type", deviceIndex < 4 ? "DISCRETE_GPU" : "INTEGRATED_GPU");
+    heading("Device Features");
+    for (const char *feature : features)
+        line(feature, booleanString(deviceRng() % 4 != 0));
+    heading("Device Limits");
+    for (const auto& limit : limits)
+        line(limit.first, std::to_string(deviceRng() % 4 ? limit.second : limit.second / 2));
+    heading("Queue Family");
+    for (uint32_t i = 0; i < 1 + deviceRng() % 3; ++i)
+    {
+        text << std::endl << "#" << i << std::endl << std::endl << "Queue flags" << std::endl;
+        text << "\tVK_QUEUE_COMPUTE_BIT" << std::endl << "\tVK_QUEUE_TRANSFER_BIT" << std::endl;
+        if (!i)
+            text << "\tVK_QUEUE_GRAPHICS_BIT" << std::endl;
+        line("Queue count", std::to_string(1 + deviceRng() % 16));
+        line("Timestamp valid bits", "64");
+    }
+    heading("Descriptor Indexing");
+    for (const char *feature : descriptorIndexingFeatures)
+        line(feature, booleanString(deviceRng() % 3 != 0));
+    heading("Device Extensions");
+    line("Name", "Specification");
+    for (const char *extension : extensions)
+    {
+        if (deviceRng() % 2)
+            line(extension, std::to_string(1 + rng() % 4));
+    }
+    return text.str();
+}
+
+static int benchmark(uint32_t snapshotCount)
+{
+    std::mt19937 rng(0);
+    std::vector<std::string> snapshots;
+    std::size_t totalSize = 0;
+    for (uint32_t i = 0; i < snapshotCount; ++i)
+    {
+        snapshots.push_back(syntheticSnapshot(rng));
+        totalSize += snapshots.back().size();
+    }
+    ColumnStore store;
+    const auto begin = Clock::now();
+    for (const auto& text : snapshots)
+    {
+        std::istringstream snapshot(text);
+        store.ingest(snapshot);
+    }
+    const double ingestTime = elapsedMilliseconds(begin, Clock::now());
+    const std::string indexFileName = "gpucaps-index-bench.bin";
+    const Timing save = measure(3, [&]() { store.save(indexFileName); });
+    const Timing load = measure(3, [&]() { ColumnStore().load(indexFileName); });
+    std::remove(indexFileName.c_str());
+    setFieldWidth(30);
+    printLn("Snapshots", snapshotCount);
+    printLn("Columns", store.getColumns().size());
+    printLn("Ingest, snapshots/s", fixedString(snapshotCount / (ingestTime / 1e3), 0));
+    printLn("Ingest, MB/s", fixedString(totalSize / 1e6 / (ingestTime / 1e3), 1));
+    printLn("Save, ms", fixedString(save.median, 1));
+    printLn("Load, ms", fixedString(load.median, 1));
+    printEndLn();
+    std::cout << "Query latency, ms" << std::endl;
+    const std::pair<const char *, const char *> queries[] = {
+        {"maxComputeSharedMemorySize >= 48K and descriptorBindingPartiallyBound", nullptr},
+        {"VK_KHR_ray_query and !VK_EXT_mesh_shader and Device type == DISCRETE_GPU", nullptr},
+        {"Max image dimension 2D >= 16K", "Device/Name"},
+        {"", "maxPushConstantsSize"}};
+    uint64_t checksum = 0;
+    for (const auto& query : queries)
+    {
+        const Timing timing = measure(100,
+            [&]()
+            {
+                const Bitmap selection = filter(store, query.first);
+                checksum += countRows(selection);
+                if (query.second)
+                    checksum += groupBy(store, selection, query.second).size();
+            });
+        std::cout << std::endl << (*query.first ? query.first : "All");
+        if (query.second)
+            std::cout << " grouped by " << query.second;
+        std::cout << std::endl;
+        printLn("Median", fixedString(timing.median, 3));
+        printLn("99th percentile", fixedString(timing.p99, 3));
+        printLn("Rows/s, millions", fixedString(store.getRowCount() / (timing.median * 1e3), 1));
+    }
+    return checksum ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        if (argc >= 2 && !strcmp(argv[1], "bench"))
+            return benchmark(argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 100000);
+        if (argc < 3)
+        {
+            printUsage();
+            return -1;
+        }
+        const std::string indexFileName = argv[1];
+        const std::string command = argv[2];
+        if ("ingest" == command)
+            return ingest(indexFileName, std::vector<std::string>(argv + 3, argv + argc));
+        if ("columns" == command)
+            return listColumns(indexFileName);
+        if ("query" == command)
+        {
+            std::string expression, groupColumn;
+            for (int i = 3; i < argc; ++i)
+            {
+                if (!strcmp(argv[i], "--group-by") && i + 1 < argc)
+                    groupColumn = argv[++i];
+                else
+                {   // Unquoted expression comes as several arguments
+                    if (!expression.empty())
+                        expression += ' ';
+                    expression += argv[i];
+                }
+            }
+            return query(indexFileName, expression, groupColumn);
+        }
+        printUsage();
+        return -1;
+    }
+    catch (const std::exception& exc)
+    {
+        std::cout << "Error: " << exc.what() << std::endl;
+        return -1;
+    }
+}
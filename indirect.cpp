@@ -0,0 +1,319 @@
+#include <cstring>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/pipeline.comp.h"
+#include "shaders/fullscreen.vert.h"
+#include "shaders/pipeline.frag.h"
+
+static const uint32_t minCommandCount = 1024;
+static const uint32_t maxDrawCount = 1024 * 1024;
+static const uint32_t maxDispatchCount = 256 * 1024;
+static const uint32_t localSize = 64;
+static const uint32_t framebufferSize = 64;
+static const uint32_t repeatCount = 10;
+
+enum class DrawMode
+{
+    Direct,
+    Indirect,
+    IndirectCount
+};
+
+// Draws cover a single pixel and dispatches a single workgroup, so that command processing dominates
+class IndirectScene
+{
+public:
+    IndirectScene(const DeviceContext& context, uint32_t queueFamilyIndex, const VkPhysicalDeviceFeatures& features);
+    Timing draw(DrawMode mode, uint32_t drawCount);
+    Timing dispatch(bool indirect, uint32_t dispatchCount);
+    bool indirectCountSupported() const noexcept { return drawIndexedIndirectCount != nullptr; }
+
+private:
+    Buffer uploadBuffer(const void *data, VkDeviceSize size, VkBufferUsageFlags usage) const;
+    double submit();
+
+    const DeviceContext& context;
+    const VkQueue queue;
+    const bool multiDrawIndirect;
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+    RenderPass renderPass;
+    Image colorImage;
+    Framebuffer framebuffer;
+    ShaderModule computeShader;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    DescriptorSetLayout descriptorSetLayout;
+    PipelineLayout pipelineLayout;
+    Pipeline graphicsPipeline;
+    Pipeline computePipeline;
+    Buffer storageBuffer;
+    Buffer indexBuffer;
+    Buffer drawBuffer;
+    Buffer countBuffer;
+    Buffer dispatchBuffer;
+    DescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    CommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    QueryPool queryPool;
+    Fence fence;
+};
+
+IndirectScene::IndirectScene(const DeviceContext& context, uint32_t queueFamilyIndex, const VkPhysicalDeviceFeatures& features):
+    context(context),
+    queue(context.getQueue(queueFamilyIndex)),
+    multiDrawIndirect(features.multiDrawIndirect != VK_FALSE),
+    renderPass(context.createRenderPass(VK_FORMAT_R8G8B8A8_UNORM)),
+    colorImage(context.createImage(VK_FORMAT_R8G8B8A8_UNORM, framebufferSize, framebufferSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)),
+    framebuffer(context.createFramebuffer(renderPass, {colorImage.view}, framebufferSize, framebufferSize)),
+    computeShader(context.createShaderModule(pipeline_comp, sizeof(pipeline_comp))),
+    vertexShader(context.createShaderModule(fullscreen_vert, sizeof(fullscreen_vert))),
+    fragmentShader(context.createShaderModule(pipeline_frag, sizeof(pipeline_frag))),
+    storageBuffer(context.createBuffer(localSize * sizeof(float) * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)),
+    commandPool(context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+    queryPool(context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 2)),
+    fence(context.createFence())
+{
+    if (context.extensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+        drawIndexedIndirectCount = context.getProc<PFN_vkCmdDrawIndexedIndirectCountKHR>("vkCmdDrawIndexedIndirectCount");
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    descriptorSetLayout = context.createDescriptorSetLayout({binding});
+    pipelineLayout = context.createPipelineLayout({descriptorSetLayout});
+    const int32_t iterations = 1;
+    const VkSpecializationMapEntry fragmentEntry = {0, 0, sizeof(int32_t)};
+    VkSpecializationInfo fragmentSpecialization;
+    fragmentSpecialization.mapEntryCount = 1;
+    fragmentSpecialization.pMapEntries = &fragmentEntry;
+    fragmentSpecialization.dataSize = sizeof(int32_t);
+    fragmentSpecialization.pData = &iterations;
+    graphicsPipeline = context.createGraphicsPipeline(vertexShader, fragmentShader, &fragmentSpecialization, pipelineLayout, renderPass);
+    const uint32_t computeConstants[] = {localSize, static_cast<uint32_t>(iterations)};
+    const VkSpecializationMapEntry computeEntries[] = {
+        {0, 0, sizeof(uint32_t)},
+        {1, sizeof(uint32_t), sizeof(int32_t)}
+    };
+    VkSpecializationInfo computeSpecialization;
+    computeSpecialization.mapEntryCount = 2;
+    computeSpecialization.pMapEntries = computeEntries;
+    computeSpecialization.dataSize = sizeof(computeConstants);
+    computeSpecialization.pData = computeConstants;
+    computePipeline = context.createComputePipeline(computeShader, &computeSpecialization, pipelineLayout);
+    descriptorPool = context.createDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+    descriptorSet = context.allocateDescriptorSet(descriptorPool, descriptorSetLayout);
+    VkDescriptorBufferInfo bufferInfo = {storageBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+    commandBuffer = context.allocateCommandBuffer(commandPool);
+    // Fullscreen vertex shader derives position from gl_VertexIndex
+    const uint32_t indices[] = {0, 1, 2};
+    indexBuffer = uploadBuffer(indices, sizeof(indices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    std::vector<VkDrawIndexedIndirectCommand> draws(maxDrawCount);
+    for (uint32_t i = 0; i < maxDrawCount; ++i)
+        draws[i] = {3, 1, 0, 0, features.drawIndirectFirstInstance ? i : 0};
+    drawBuffer = uploadBuffer(draws.data(), draws.size() * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    const uint32_t count = 0;
+    countBuffer = uploadBuffer(&count, sizeof(count), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    const std::vector<VkDispatchIndirectCommand> dispatches(maxDispatchCount, {1, 1, 1});
+    dispatchBuffer = uploadBuffer(dispatches.data(), dispatches.size() * sizeof(VkDispatchIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+}
+
+// Indirect commands are fetched from device local memory, as GPU-driven renderer would generate them
+Buffer IndirectScene::uploadBuffer(const void *data, VkDeviceSize size, VkBufferUsageFlags usage) const
+{
+    Buffer stagingBuffer = context.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    memcpy(stagingBuffer.data, data, static_cast<std::size_t>(size));
+    Buffer buffer = context.createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    const VkBufferCopy region = {0, 0, size};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, 1, &region);
+    endCommandBuffer(commandBuffer);
+    context.submitAndWait(queue, commandBuffer, fence);
+    return buffer;
+}
+
+Timing IndirectScene::draw(DrawMode mode, uint32_t drawCount)
+{
+    const VkClearValue clearValue = {};
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea = {{0, 0}, {framebufferSize, framebufferSize}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    const VkViewport viewport = {0.f, 0.f, float(framebufferSize), float(framebufferSize), 0.f, 1.f};
+    const VkRect2D scissor = {{0, 0}, {1, 1}};
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+    if (DrawMode::IndirectCount == mode)
+    {
+        vkCmdUpdateBuffer(commandBuffer, countBuffer, 0, sizeof(uint32_t), &drawCount);
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = countBuffer;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    switch (mode)
+    {
+    case DrawMode::Direct:
+        for (uint32_t i = 0; i < drawCount; ++i)
+            vkCmdDrawIndexed(commandBuffer, 3, 1, 0, 0, i);
+        break;
+    case DrawMode::Indirect:
+        if (multiDrawIndirect)
+            vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, 0, drawCount, static_cast<uint32_t>(stride));
+        else
+        {   // drawCount must be 0 or 1
+            for (uint32_t i = 0; i < drawCount; ++i)
+                vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, i * stride, 1, static_cast<uint32_t>(stride));
+        }
+        break;
+    case DrawMode::IndirectCount:
+        drawIndexedIndirectCount(commandBuffer, drawBuffer, 0, countBuffer, 0, drawCount, static_cast<uint32_t>(stride));
+        break;
+    }
+    vkCmdEndRenderPass(commandBuffer);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    endCommandBuffer(commandBuffer);
+    return measureSamples(repeatCount, [this]() { return submit(); });
+}
+
+Timing IndirectScene::dispatch(bool indirect, uint32_t dispatchCount)
+{
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    for (uint32_t i = 0; i < dispatchCount; ++i)
+    {
+        if (indirect)
+            vkCmdDispatchIndirect(commandBuffer, dispatchBuffer, i * sizeof(VkDispatchIndirectCommand));
+        else
+            vkCmdDispatch(commandBuffer, 1, 1, 1);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    endCommandBuffer(commandBuffer);
+    return measureSamples(repeatCount, [this]() { return submit(); });
+}
+
+// Returns GPU time between two timestamps in milliseconds
+double IndirectScene::submit()
+{
+    context.submitAndWait(queue, commandBuffer, fence);
+    uint64_t timestamps[2];
+    checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+    return context.timestampDelta(timestamps[0], timestamps[1]);
+}
+
+// Returns millions of commands per second
+static std::string throughputString(uint32_t commandCount, const Timing& timing)
+{
+    return fixedString(commandCount / (timing.median * 1e3), 2);
+}
+
+void benchmarkIndirect(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice->getHandle(), &features);
+    DeviceOptions options;
+    options.features.multiDrawIndirect = features.multiDrawIndirect;
+    options.features.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
+    if (deviceExtensionSupported(physicalDevice->getHandle(), VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+        options.extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    DeviceContext context(physicalDevice->getHandle(), options);
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+    if (UINT32_MAX == queueFamilyIndex)
+        throw BenchmarkSkipped("no graphics queue family");
+    if (!context.getQueueFamilies()[queueFamilyIndex].timestampValidBits)
+        throw BenchmarkSkipped("timestamps not supported by graphics queue");
+    IndirectScene scene(context, queueFamilyIndex, features);
+    // Multi-draw is limited by maxDrawIndirectCount, which is 1 without multiDrawIndirect
+    const uint32_t maxDrawIndirectCount = context.getLimits().maxDrawIndirectCount;
+    std::vector<uint32_t> drawCounts;
+    for (uint32_t drawCount = minCommandCount; drawCount <= maxDrawCount; drawCount *= 4)
+        drawCounts.push_back(drawCount);
+    if (maxDrawIndirectCount > minCommandCount && maxDrawIndirectCount < maxDrawCount)
+    {   // Limit itself is measured too if it is inside of sweep
+        const auto it = std::lower_bound(drawCounts.begin(), drawCounts.end(), maxDrawIndirectCount);
+        if (*it != maxDrawIndirectCount)
+            drawCounts.insert(it, maxDrawIndirectCount);
+    }
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Multi draw indirect", booleanString(features.multiDrawIndirect));
+    printLn("Draw indirect first instance", booleanString(features.drawIndirectFirstInstance));
+    printLn("Max draw indirect count", uint32String(maxDrawIndirectCount));
+    printLn("Draw indirect count", booleanString(scene.indirectCountSupported()));
+    if (!features.multiDrawIndirect)
+        std::cout << "Indirect draws are issued one per command" << std::endl;
+    printEndLn();
+    printRow({"Draws", "Direct, M/s", "Indirect, M/s", "Ind. count, M/s"});
+    for (uint32_t drawCount : drawCounts)
+    {
+        const std::string path = "draws=" + std::to_string(drawCount) + "/";
+        std::vector<std::string> cells = {std::to_string(drawCount)};
+        const Timing direct = scene.draw(DrawMode::Direct, drawCount);
+        recordResult(path + "direct", direct);
+        cells.push_back(throughputString(drawCount, direct));
+        if (!features.multiDrawIndirect || drawCount <= maxDrawIndirectCount)
+        {
+            const Timing indirect = scene.draw(DrawMode::Indirect, drawCount);
+            recordResult(path + "indirect", indirect);
+            cells.push_back(throughputString(drawCount, indirect));
+        }
+        else
+            cells.push_back("Over limit");
+        if (!scene.indirectCountSupported())
+            cells.push_back("Not supported");
+        else if (drawCount > maxDrawIndirectCount)
+            cells.push_back("Over limit");
+        else
+        {
+            const Timing indirectCount = scene.draw(DrawMode::IndirectCount, drawCount);
+            recordResult(path + "indirect count", indirectCount);
+            cells.push_back(throughputString(drawCount, indirectCount));
+        }
+        printRow(cells);
+    }
+    printEndLn();
+    printRow({"Dispatches", "Direct, M/s", "Indirect, M/s"});
+    for (uint32_t dispatchCount = minCommandCount; dispatchCount <= maxDispatchCount; dispatchCount *= 4)
+    {
+        const std::string path = "dispatches=" + std::to_string(dispatchCount) + "/";
+        const Timing direct = scene.dispatch(false, dispatchCount);
+        const Timing indirect = scene.dispatch(true, dispatchCount);
+        recordResult(path + "direct", direct);
+        recordResult(path + "indirect", indirect);
+        printRow({
+            std::to_string(dispatchCount),
+            throughputString(dispatchCount, direct),
+            throughputString(dispatchCount, indirect)});
+    }
+}
@@ -0,0 +1,374 @@
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/grid.vert.h"
+#include "shaders/pipeline.frag.h"
+
+static const uint32_t frameWidth = 1920;
+static const uint32_t frameHeight = 1080;
+static const uint32_t cellsPerSide = 64; // See grid.vert
+static const uint32_t layerCount = 4;
+static const int32_t fragmentIterations = 16;
+static const uint32_t repeatCount = 20;
+static const VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+struct MsaaResult
+{
+    Timing render;
+    Timing resolve; // vkCmdResolveImage after render pass
+    Timing subpassResolve; // Render pass with resolve attachment, multisampled image isn't stored
+};
+
+// Layers of small rotated triangles with depth test, rendered at given sample count
+class MsaaScene
+{
+public:
+    MsaaScene(const DeviceContext& context, uint32_t queueFamilyIndex, VkSampleCountFlagBits samples, VkFormat depthFormat);
+    MsaaResult run(bool sampleShading);
+
+private:
+    RenderPass createRenderPass(bool resolve) const;
+    Pipeline createPipeline(VkRenderPass renderPass, bool sampleShading) const;
+    void beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkPipeline pipeline) const;
+    std::vector<double> submit(uint32_t queryCount);
+
+    const DeviceContext& context;
+    const VkQueue queue;
+    const VkSampleCountFlagBits samples;
+    const VkFormat depthFormat;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    PipelineLayout pipelineLayout;
+    Image colorImage;
+    Image depthImage;
+    ImageView depthView;
+    Image resolvedImage;
+    RenderPass storeRenderPass;
+    RenderPass resolveRenderPass;
+    Framebuffer storeFramebuffer;
+    Framebuffer resolveFramebuffer;
+    CommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    QueryPool queryPool;
+    Fence fence;
+};
+
+MsaaScene::MsaaScene(const DeviceContext& context, uint32_t queueFamilyIndex, VkSampleCountFlagBits samples, VkFormat depthFormat):
+    context(context),
+    queue(context.getQueue(queueFamilyIndex)),
+    samples(samples),
+    depthFormat(depthFormat),
+    vertexShader(context.createShaderModule(grid_vert, sizeof(grid_vert))),
+    fragmentShader(context.createShaderModule(pipeline_frag, sizeof(pipeline_frag))),
+    pipelineLayout(context.createPipelineLayout({})),
+    colorImage(context.createImage(colorFormat, frameWidth, frameHeight,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, samples)),
+    depthImage(context.createImage(depthFormat, frameWidth, frameHeight, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, samples)),
+    resolvedImage(context.createImage(colorFormat, frameWidth, frameHeight,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)),
+    storeRenderPass(createRenderPass(false)),
+    commandPool(context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+    queryPool(context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 3)),
+    fence(context.createFence())
+{   // Default view of image is created only for color usage
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = depthImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    VkImageView view;
+    checkResult(vkCreateImageView(context.getDevice(), &viewInfo, nullptr, &view), "vkCreateImageView");
+    depthView = ImageView(context.getDevice(), view);
+    storeFramebuffer = context.createFramebuffer(storeRenderPass, {colorImage.view, depthView}, frameWidth, frameHeight);
+    if (samples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        resolveRenderPass = createRenderPass(true);
+        resolveFramebuffer = context.createFramebuffer(resolveRenderPass, {colorImage.view, depthView, resolvedImage.view},
+            frameWidth, frameHeight);
+    }
+    commandBuffer = context.allocateCommandBuffer(commandPool);
+}
+
+RenderPass MsaaScene::createRenderPass(bool resolve) const
+{
+    VkAttachmentDescription attachments[3] = {};
+    for (auto& attachment : attachments)
+    {
+        attachment.samples = samples;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    attachments[0].format = colorFormat;
+    attachments[0].storeOp = resolve ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].finalLayout = resolve ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    attachments[1].format = depthFormat;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    attachments[2].format = colorFormat;
+    attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[2].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    const VkAttachmentReference colorAttachment = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    const VkAttachmentReference depthAttachment = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    const VkAttachmentReference resolveAttachment = {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachment;
+    subpass.pResolveAttachments = resolve ? &resolveAttachment : nullptr;
+    subpass.pDepthStencilAttachment = &depthAttachment;
+    // Stored image is resolved by transfer command
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = 0;
+    dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = resolve ? 3 : 2;
+    renderPassInfo.pAttachments = attachments;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = resolve ? 0 : 1;
+    renderPassInfo.pDependencies = &dependency;
+    VkRenderPass renderPass;
+    checkResult(vkCreateRenderPass(context.getDevice(), &renderPassInfo, nullptr, &renderPass), "vkCreateRenderPass");
+    return RenderPass(context.getDevice(), renderPass);
+}
+
+// Unlike DeviceContext::createGraphicsPipeline(), has depth test and optional sample shading
+Pipeline MsaaScene::createPipeline(VkRenderPass renderPass, bool sampleShading) const
+{
+    const VkSpecializationMapEntry mapEntry = {0, 0, sizeof(int32_t)};
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &mapEntry;
+    specializationInfo.dataSize = sizeof(int32_t);
+    specializationInfo.pData = &fragmentIterations;
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertexShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragmentShader;
+    stages[1].pName = "main";
+    stages[1].pSpecializationInfo = &specializationInfo;
+    VkPipelineVertexInputStateCreateInfo vertexInputState = {};
+    vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
+    inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo rasterizationState = {};
+    rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizationState.cullMode = VK_CULL_MODE_NONE;
+    rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizationState.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisampleState = {};
+    multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleState.rasterizationSamples = samples;
+    multisampleState.sampleShadingEnable = sampleShading;
+    multisampleState.minSampleShading = 1.f;
+    VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
+    depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilState.depthTestEnable = VK_TRUE;
+    depthStencilState.depthWriteEnable = VK_TRUE;
+    depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS;
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colorBlendState = {};
+    colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendState.attachmentCount = 1;
+    colorBlendState.pAttachments = &blendAttachment;
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInputState;
+    pipelineInfo.pInputAssemblyState = &inputAssemblyState;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizationState;
+    pipelineInfo.pMultisampleState = &multisampleState;
+    pipelineInfo.pDepthStencilState = &depthStencilState;
+    pipelineInfo.pColorBlendState = &colorBlendState;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    VkPipeline pipeline;
+    checkResult(vkCreateGraphicsPipelines(context.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline),
+        "vkCreateGraphicsPipelines");
+    return Pipeline(context.getDevice(), pipeline);
+}
+
+void MsaaScene::beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkPipeline pipeline) const
+{
+    VkClearValue clearValues[2] = {};
+    clearValues[1].depthStencil = {1.f, 0};
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea = {{0, 0}, {frameWidth, frameHeight}};
+    renderPassInfo.clearValueCount = 2;
+    renderPassInfo.pClearValues = clearValues;
+    const VkViewport viewport = {0.f, 0.f, float(frameWidth), float(frameHeight), 0.f, 1.f};
+    const VkRect2D scissor = {{0, 0}, {frameWidth, frameHeight}};
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    vkCmdDraw(commandBuffer, cellsPerSide * cellsPerSide * 3, layerCount, 0, 0);
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+MsaaResult MsaaScene::run(bool sampleShading)
+{
+    const bool multisampled = samples != VK_SAMPLE_COUNT_1_BIT;
+    MsaaResult result;
+    Pipeline pipeline = createPipeline(storeRenderPass, sampleShading);
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 3);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    beginRenderPass(storeRenderPass, storeFramebuffer, pipeline);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    if (multisampled)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = resolvedImage;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+        VkImageResolve region = {};
+        region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.extent = {frameWidth, frameHeight, 1};
+        vkCmdResolveImage(commandBuffer, colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            resolvedImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2);
+    }
+    endCommandBuffer(commandBuffer);
+    // Resolve is filtered along with render pass of the same submission
+    const std::vector<Timing> timings = measurePaired(repeatCount,
+        [&]() { return submit(multisampled ? 3 : 2); });
+    result.render = timings[0];
+    if (!multisampled)
+        return result;
+    result.resolve = timings[1];
+    pipeline = createPipeline(resolveRenderPass, sampleShading);
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    beginRenderPass(resolveRenderPass, resolveFramebuffer, pipeline);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    endCommandBuffer(commandBuffer);
+    result.subpassResolve = measureSamples(repeatCount, [this]() { return submit(2)[0]; });
+    return result;
+}
+
+// Returns GPU time between consecutive timestamps in milliseconds
+std::vector<double> MsaaScene::submit(uint32_t queryCount)
+{
+    context.submitAndWait(queue, commandBuffer, fence);
+    uint64_t timestamps[3];
+    checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, queryCount, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+    std::vector<double> deltas;
+    for (uint32_t i = 1; i < queryCount; ++i)
+        deltas.push_back(context.timestampDelta(timestamps[i - 1], timestamps[i]));
+    return deltas;
+}
+
+// Returns sample counts of optimal tiling 2D image of given format and usage
+static VkSampleCountFlags imageSampleCounts(VkPhysicalDevice physicalDevice, VkFormat format, VkImageUsageFlags usage)
+{
+    VkImageFormatProperties formatProperties;
+    const VkResult result = vkGetPhysicalDeviceImageFormatProperties(physicalDevice, format, VK_IMAGE_TYPE_2D,
+        VK_IMAGE_TILING_OPTIMAL, usage, 0, &formatProperties);
+    return (VK_SUCCESS == result) ? formatProperties.sampleCounts : 0;
+}
+
+void benchmarkMsaa(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice->getHandle(), &features);
+    DeviceOptions options;
+    options.features.sampleRateShading = features.sampleRateShading;
+    DeviceContext context(physicalDevice->getHandle(), options);
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
+    if (UINT32_MAX == queueFamilyIndex)
+        throw BenchmarkSkipped("no graphics queue family");
+    if (!context.getQueueFamilies()[queueFamilyIndex].timestampValidBits)
+        throw BenchmarkSkipped("timestamps not supported by graphics queue");
+    // D16 depth attachment support is mandatory
+    VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(context.getPhysicalDevice(), depthFormat, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        depthFormat = VK_FORMAT_D16_UNORM;
+    const VkPhysicalDeviceLimits& limits = context.getLimits();
+    const VkSampleCountFlags sampleCounts = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts &
+        imageSampleCounts(context.getPhysicalDevice(), colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT) &
+        imageSampleCounts(context.getPhysicalDevice(), depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Frame size", frameWidth, frameHeight);
+    printLn("Triangles", cellsPerSide * cellsPerSide * layerCount);
+    printLn("Depth format", (VK_FORMAT_D32_SFLOAT == depthFormat) ? "D32_SFLOAT" : "D16_UNORM");
+    printLn("Sample counts", sampleCountsString(sampleCounts));
+    printLn("Sample rate shading", booleanString(features.sampleRateShading));
+    printEndLn();
+    printRow({"Samples", "Sample shading", "Render, ms", "Resolve, ms", "Subpass res., ms"});
+    for (uint32_t samples = VK_SAMPLE_COUNT_1_BIT; samples <= VK_SAMPLE_COUNT_64_BIT; samples <<= 1)
+    {
+        if (!(sampleCounts & samples))
+            continue;
+        MsaaScene scene(context, queueFamilyIndex, static_cast<VkSampleCountFlagBits>(samples), depthFormat);
+        for (bool sampleShading : {false, true})
+        {   // Single sample is shaded once anyway
+            if (sampleShading && (!features.sampleRateShading || VK_SAMPLE_COUNT_1_BIT == samples))
+                continue;
+            const MsaaResult result = scene.run(sampleShading);
+            const std::string path = "samples=" + std::to_string(samples) + (sampleShading ? "/sample shading/" : "/");
+            recordResult(path + "render", result.render);
+            std::vector<std::string> cells = {
+                std::to_string(samples),
+                sampleShading ? "On" : "Off",
+                fixedString(result.render.median, 3)};
+            if (VK_SAMPLE_COUNT_1_BIT == samples)
+                cells.insert(cells.end(), {"-", "-"});
+            else
+            {
+                recordResult(path + "resolve", result.resolve);
+                recordResult(path + "subpass resolve", result.subpassResolve);
+                cells.push_back(fixedString(result.resolve.median, 3));
+                cells.push_back(fixedString(result.subpassResolve.median, 3));
+            }
+            printRow(cells);
+        }
+    }
+}
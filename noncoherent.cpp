@@ -0,0 +1,233 @@
+#include <cstring>
+#include "gpucaps.h"
+#include "benchmark.h"
+
+static const VkDeviceSize bufferSize = 16 * 1024 * 1024;
+static const VkDeviceSize chunkSize = 64;
+static const VkDeviceSize chunkStride = 4096;
+static const uint32_t maxChunkCount = static_cast<uint32_t>(bufferSize / chunkStride);
+static const uint32_t repeatCount = 20;
+// Both host visible buffers use the same usage, so they share allowed memory types
+static const VkBufferUsageFlags hostBufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+// Returns UINT32_MAX if there is no such type; cached types are preferred
+static uint32_t findHostVisibleMemoryType(const DeviceContext& context, uint32_t memoryTypeBits, bool coherent)
+{
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = context.getMemoryProperties();
+    uint32_t memoryTypeIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if (!(memoryTypeBits & (1u << i)) ||
+            !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ||
+            (coherent != ((flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)))
+            continue;
+        if (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+            return i;
+        if (UINT32_MAX == memoryTypeIndex)
+            memoryTypeIndex = i;
+    }
+    return memoryTypeIndex;
+}
+
+// Expands range to nonCoherentAtomSize boundaries as required by vkFlushMappedMemoryRanges
+static VkMappedMemoryRange alignedRange(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize atomSize)
+{
+    const VkDeviceSize begin = offset / atomSize * atomSize;
+    const VkDeviceSize end = std::min((offset + size + atomSize - 1) / atomSize * atomSize, bufferSize);
+    VkMappedMemoryRange range = {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = memory;
+    range.offset = begin;
+    range.size = end - begin;
+    return range;
+}
+
+static std::vector<VkMappedMemoryRange> chunkRanges(VkDeviceMemory memory, uint32_t chunkCount, VkDeviceSize atomSize)
+{
+    std::vector<VkMappedMemoryRange> ranges;
+    for (uint32_t i = 0; i < chunkCount; ++i)
+        ranges.push_back(alignedRange(memory, i * chunkStride, chunkSize, atomSize));
+    return ranges;
+}
+
+static void writeChunks(void *data, uint32_t chunkCount, int value)
+{
+    for (uint32_t i = 0; i < chunkCount; ++i)
+        memset(static_cast<uint8_t *>(data) + i * chunkStride, value, static_cast<std::size_t>(chunkSize));
+}
+
+struct RangeResult
+{
+    Timing perRange;
+    Timing batched;
+    Timing coalesced;
+};
+
+typedef VkResult (VKAPI_PTR *MappedMemoryRangesFunc)(VkDevice, uint32_t, const VkMappedMemoryRange *);
+
+// Same chunks submitted one range per call, all ranges in one call, or as one range that spans them.
+// Chunks are dirtied by host before flush.
+static RangeResult measureRanges(const DeviceContext& context, const Buffer& buffer, uint32_t chunkCount,
+    MappedMemoryRangesFunc func, const char *call, bool flush)
+{
+    const VkDevice device = context.getDevice();
+    const VkDeviceSize atomSize = context.getLimits().nonCoherentAtomSize;
+    const std::vector<VkMappedMemoryRange> ranges = chunkRanges(buffer.memory, chunkCount, atomSize);
+    const VkMappedMemoryRange coalescedRange = alignedRange(buffer.memory, 0,
+        (chunkCount - 1) * chunkStride + chunkSize, atomSize);
+    RangeResult result;
+    int value = 0;
+    auto measureCalls = [&](auto calls)
+    {
+        return measureSamples(repeatCount,
+            [&]()
+            {
+                if (flush)
+                    writeChunks(buffer.data, chunkCount, ++value);
+                const auto begin = Clock::now();
+                calls();
+                return elapsedMilliseconds(begin, Clock::now());
+            });
+    };
+    result.perRange = measureCalls(
+        [&]()
+        {
+            for (const auto& range : ranges)
+                checkResult(func(device, 1, &range), call);
+        });
+    result.batched = measureCalls(
+        [&]()
+        {
+            checkResult(func(device, chunkCount, ranges.data()), call);
+        });
+    result.coalesced = measureCalls(
+        [&]()
+        {
+            checkResult(func(device, 1, &coalescedRange), call);
+        });
+    return result;
+}
+
+struct UploadResult
+{
+    Timing bulk;
+    Timing scattered;
+};
+
+// Host writes, flush if needed, then transfer to device local buffer
+static UploadResult measureUpload(const DeviceContext& context, uint32_t memoryTypeIndex, VkBuffer dstBuffer)
+{
+    const VkDevice device = context.getDevice();
+    const bool coherent = (context.getMemoryProperties().memoryTypes[memoryTypeIndex].propertyFlags &
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    const VkDeviceSize atomSize = context.getLimits().nonCoherentAtomSize;
+    Buffer srcBuffer = context.createBuffer(bufferSize, hostBufferUsage, memoryTypeIndex, nullptr);
+    const std::vector<VkMappedMemoryRange> ranges = chunkRanges(srcBuffer.memory, maxChunkCount, atomSize);
+    const std::vector<uint8_t> source(static_cast<std::size_t>(bufferSize), 0x5A);
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_TRANSFER_BIT);
+    const VkQueue queue = context.getQueue(queueFamilyIndex);
+    CommandPool commandPool = context.createCommandPool(queueFamilyIndex);
+    Fence fence = context.createFence();
+    VkCommandBuffer bulkCopy = context.allocateCommandBuffer(commandPool);
+    beginCommandBuffer(bulkCopy);
+    const VkBufferCopy region = {0, 0, bufferSize};
+    vkCmdCopyBuffer(bulkCopy, srcBuffer, dstBuffer, 1, &region);
+    endCommandBuffer(bulkCopy);
+    VkCommandBuffer scatteredCopy = context.allocateCommandBuffer(commandPool);
+    std::vector<VkBufferCopy> regions;
+    for (uint32_t i = 0; i < maxChunkCount; ++i)
+        regions.push_back({i * chunkStride, i * chunkStride, chunkSize});
+    beginCommandBuffer(scatteredCopy);
+    vkCmdCopyBuffer(scatteredCopy, srcBuffer, dstBuffer, maxChunkCount, regions.data());
+    endCommandBuffer(scatteredCopy);
+    UploadResult result;
+    result.bulk = measure(repeatCount,
+        [&]()
+        {
+            memcpy(srcBuffer.data, source.data(), source.size());
+            if (!coherent)
+            {
+                const VkMappedMemoryRange range = alignedRange(srcBuffer.memory, 0, bufferSize, atomSize);
+                checkResult(vkFlushMappedMemoryRanges(device, 1, &range), "vkFlushMappedMemoryRanges");
+            }
+            context.submitAndWait(queue, bulkCopy, fence);
+        });
+    int value = 0;
+    result.scattered = measure(repeatCount,
+        [&]()
+        {
+            writeChunks(srcBuffer.data, maxChunkCount, ++value);
+            if (!coherent)
+                checkResult(vkFlushMappedMemoryRanges(device, maxChunkCount, ranges.data()), "vkFlushMappedMemoryRanges");
+            context.submitAndWait(queue, scatteredCopy, fence);
+        });
+    return result;
+}
+
+static std::string microsecondsString(const Timing& timing)
+{
+    return fixedString(timing.median * 1e3, 2);
+}
+
+void benchmarkNonCoherentMemory(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    DeviceContext context(physicalDevice->getHandle());
+    const uint32_t memoryTypeBits = context.getBufferMemoryTypeBits(hostBufferUsage);
+    const uint32_t nonCoherentTypeIndex = findHostVisibleMemoryType(context, memoryTypeBits, false);
+    if (UINT32_MAX == nonCoherentTypeIndex)
+        throw BenchmarkSkipped("no host visible memory type without HOST_COHERENT allowed for buffers");
+    const uint32_t coherentTypeIndex = findHostVisibleMemoryType(context, memoryTypeBits, true);
+    Buffer buffer = context.createBuffer(bufferSize, hostBufferUsage, nonCoherentTypeIndex, nullptr);
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Non-coherent atom size", context.getLimits().nonCoherentAtomSize);
+    printLn("Non-coherent memory type", nonCoherentTypeIndex);
+    if (coherentTypeIndex != UINT32_MAX)
+        printLn("Coherent memory type", coherentTypeIndex);
+    printLn("Chunk size", chunkSize);
+    printLn("Chunk stride", chunkStride);
+    for (const auto& operation : {
+        std::make_pair("vkFlushMappedMemoryRanges", vkFlushMappedMemoryRanges),
+        std::make_pair("vkInvalidateMappedMemoryRanges", vkInvalidateMappedMemoryRanges)})
+    {
+        printEndLn();
+        std::cout << operation.first << ", us" << std::endl;
+        printRow({"Chunks", "Per range", "Batched", "Coalesced"});
+        for (uint32_t chunkCount = 1; chunkCount <= maxChunkCount; chunkCount *= 4)
+        {
+            const RangeResult result = measureRanges(context, buffer, chunkCount, operation.second, operation.first,
+                operation.second == vkFlushMappedMemoryRanges);
+            const std::string path = std::string(operation.first) + "/chunks=" + std::to_string(chunkCount) + "/";
+            recordResult(path + "per range", result.perRange);
+            recordResult(path + "batched", result.batched);
+            recordResult(path + "coalesced", result.coalesced);
+            printRow({
+                std::to_string(chunkCount),
+                microsecondsString(result.perRange),
+                microsecondsString(result.batched),
+                microsecondsString(result.coalesced)});
+        }
+    }
+    Buffer dstBuffer = context.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    printEndLn();
+    std::cout << "Upload to device local buffer" << std::endl;
+    printRow({"Memory type", "Bulk, GB/s", "Scattered, us"});
+    for (uint32_t memoryTypeIndex : {coherentTypeIndex, nonCoherentTypeIndex})
+    {
+        if (UINT32_MAX == memoryTypeIndex)
+        {
+            printRow({"Coherent", "Not supported"});
+            continue;
+        }
+        const UploadResult result = measureUpload(context, memoryTypeIndex, dstBuffer);
+        const std::string path = "upload/memory type=" + std::to_string(memoryTypeIndex) + "/";
+        recordResult(path + "bulk", result.bulk);
+        recordResult(path + "scattered", result.scattered);
+        printRow({
+            (memoryTypeIndex == coherentTypeIndex ? "Coherent #" : "Non-coherent #") + std::to_string(memoryTypeIndex),
+            fixedString(gigabytesPerSecond(bufferSize, result.bulk.median), 2),
+            microsecondsString(result.scattered)});
+    }
+}
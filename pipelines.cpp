@@ -0,0 +1,222 @@
+#include <atomic>
+#include <cstddef>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/pipeline.comp.h"
+#include "shaders/fullscreen.vert.h"
+#include "shaders/pipeline.frag.h"
+
+static const uint32_t computeVariantCount = 64;
+static const uint32_t graphicsVariantCount = 64;
+static const uint32_t repeatCount = 3;
+
+struct SpecializationConstants
+{
+    uint32_t localSize;
+    int32_t iterations;
+    float scale;
+};
+
+// Compute and graphics pipelines that differ only by specialization constants
+class PipelineSet
+{
+public:
+    explicit PipelineSet(const DeviceContext& context);
+    uint32_t getPipelineCount() const noexcept { return computeVariantCount + graphicsVariantCount; }
+    // Different salt produces pipelines that driver haven't seen yet
+    Pipeline createPipeline(uint32_t index, uint32_t salt, VkPipelineCache pipelineCache) const;
+
+private:
+    Pipeline createComputePipeline(const SpecializationConstants& constants, VkPipelineCache pipelineCache) const;
+    Pipeline createGraphicsPipeline(const SpecializationConstants& constants, VkPipelineCache pipelineCache) const;
+
+    const DeviceContext& context;
+    ShaderModule computeShader;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    DescriptorSetLayout descriptorSetLayout;
+    PipelineLayout computeLayout;
+    PipelineLayout graphicsLayout;
+    RenderPass renderPass;
+};
+
+PipelineSet::PipelineSet(const DeviceContext& context):
+    context(context),
+    computeShader(context.createShaderModule(pipeline_comp, sizeof(pipeline_comp))),
+    vertexShader(context.createShaderModule(fullscreen_vert, sizeof(fullscreen_vert))),
+    fragmentShader(context.createShaderModule(pipeline_frag, sizeof(pipeline_frag)))
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    descriptorSetLayout = context.createDescriptorSetLayout({binding});
+    computeLayout = context.createPipelineLayout({descriptorSetLayout});
+    graphicsLayout = context.createPipelineLayout({});
+    renderPass = context.createRenderPass(VK_FORMAT_R8G8B8A8_UNORM);
+}
+
+Pipeline PipelineSet::createPipeline(uint32_t index, uint32_t salt, VkPipelineCache pipelineCache) const
+{
+    SpecializationConstants constants;
+    constants.scale = 1.f + static_cast<float>(salt * getPipelineCount() + index);
+    if (index < computeVariantCount)
+    {
+        constants.localSize = 16 << (index % 4);
+        constants.iterations = 4 + index/4;
+        return createComputePipeline(constants, pipelineCache);
+    }
+    index -= computeVariantCount;
+    constants.localSize = 0;
+    constants.iterations = 4 + index;
+    return createGraphicsPipeline(constants, pipelineCache);
+}
+
+Pipeline PipelineSet::createComputePipeline(const SpecializationConstants& constants, VkPipelineCache pipelineCache) const
+{
+    const VkSpecializationMapEntry mapEntries[] = {
+        {0, offsetof(SpecializationConstants, localSize), sizeof(uint32_t)},
+        {1, offsetof(SpecializationConstants, iterations), sizeof(int32_t)},
+        {2, offsetof(SpecializationConstants, scale), sizeof(float)}
+    };
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 3;
+    specializationInfo.pMapEntries = mapEntries;
+    specializationInfo.dataSize = sizeof(SpecializationConstants);
+    specializationInfo.pData = &constants;
+    return context.createComputePipeline(computeShader, &specializationInfo, computeLayout, pipelineCache);
+}
+
+Pipeline PipelineSet::createGraphicsPipeline(const SpecializationConstants& constants, VkPipelineCache pipelineCache) const
+{
+    const VkSpecializationMapEntry mapEntries[] = {
+        {0, offsetof(SpecializationConstants, iterations), sizeof(int32_t)},
+        {1, offsetof(SpecializationConstants, scale), sizeof(float)}
+    };
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 2;
+    specializationInfo.pMapEntries = mapEntries;
+    specializationInfo.dataSize = sizeof(SpecializationConstants);
+    specializationInfo.pData = &constants;
+    return context.createGraphicsPipeline(vertexShader, fragmentShader, &specializationInfo,
+        graphicsLayout, renderPass, VK_SAMPLE_COUNT_1_BIT, pipelineCache);
+}
+
+// Creates all pipelines of the set from every thread of the pool, returns elapsed milliseconds
+static double createPipelines(const PipelineSet& pipelineSet, ThreadPool& threadPool, uint32_t salt, VkPipelineCache pipelineCache)
+{
+    const uint32_t pipelineCount = pipelineSet.getPipelineCount();
+    std::vector<Pipeline> pipelines(pipelineCount);
+    std::atomic<uint32_t> nextIndex(0);
+    // Pipelines are destroyed after timing
+    return threadPool.run(
+        [&](uint32_t /* threadIndex */)
+        {
+            for (uint32_t index = nextIndex++; index < pipelineCount; index = nextIndex++)
+                pipelines[index] = pipelineSet.createPipeline(index, salt, pipelineCache);
+        });
+}
+
+static PipelineCache createPipelineCache(const DeviceContext& context, const std::vector<uint8_t>& initialData)
+{
+    VkPipelineCacheCreateInfo pipelineCacheInfo = {};
+    pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheInfo.initialDataSize = initialData.size();
+    pipelineCacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    VkPipelineCache pipelineCache;
+    checkResult(vkCreatePipelineCache(context.getDevice(), &pipelineCacheInfo, nullptr, &pipelineCache), "vkCreatePipelineCache");
+    return PipelineCache(context.getDevice(), pipelineCache);
+}
+
+static std::vector<uint8_t> getPipelineCacheData(const DeviceContext& context, VkPipelineCache pipelineCache)
+{
+    std::size_t dataSize = 0;
+    checkResult(vkGetPipelineCacheData(context.getDevice(), pipelineCache, &dataSize, nullptr), "vkGetPipelineCacheData");
+    std::vector<uint8_t> data(dataSize);
+    checkResult(vkGetPipelineCacheData(context.getDevice(), pipelineCache, &dataSize, data.data()), "vkGetPipelineCacheData");
+    data.resize(dataSize);
+    return data;
+}
+
+// Serialized cache is only usable if its header matches the device
+static bool pipelineCacheDataCompatible(const std::vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties)
+{
+    const std::size_t uuidOffset = 4 * sizeof(uint32_t);
+    if (data.size() < uuidOffset + VK_UUID_SIZE)
+        return false;
+    uint32_t header[4];
+    memcpy(header, data.data(), sizeof(header));
+    return (header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+        (header[2] == properties.vendorID) &&
+        (header[3] == properties.deviceID) &&
+        !memcmp(data.data() + uuidOffset, properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+struct PipelineCreationResult
+{
+    Timing noCache;
+    Timing coldCache;
+    Timing warmCache;
+};
+
+void benchmarkPipelines(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    DeviceContext context(physicalDevice->getHandle());
+    PipelineSet pipelineSet(context);
+    const uint32_t pipelineCount = pipelineSet.getPipelineCount();
+    const std::vector<uint32_t> threadCounts = threadCountSeries();
+    uint32_t salt = 0;
+    std::vector<uint8_t> lastCacheData;
+    std::vector<PipelineCreationResult> results;
+    for (uint32_t threadCount : threadCounts)
+    {
+        ThreadPool threadPool(threadCount);
+        PipelineCreationResult result;
+        result.noCache = measureSamples(repeatCount,
+            [&]()
+            {
+                return createPipelines(pipelineSet, threadPool, salt++, VK_NULL_HANDLE);
+            });
+        std::vector<double> coldSamples, warmSamples;
+        for (uint32_t i = 0; i < repeatCount; ++i, ++salt)
+        {   // Cold cache is filled and serialized, then the same pipelines are created from deserialized blob
+            PipelineCache coldCache = createPipelineCache(context, {});
+            coldSamples.push_back(createPipelines(pipelineSet, threadPool, salt, coldCache));
+            lastCacheData = getPipelineCacheData(context, coldCache);
+            PipelineCache warmCache = createPipelineCache(context, lastCacheData);
+            warmSamples.push_back(createPipelines(pipelineSet, threadPool, salt, warmCache));
+        }
+        result.coldCache = summarize(std::move(coldSamples));
+        result.warmCache = summarize(std::move(warmSamples));
+        results.push_back(result);
+    }
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Pipeline cache UUID", uuidString(context.getProperties().pipelineCacheUUID));
+    printLn("Pipeline cache data size", lastCacheData.size());
+    printLn("Pipeline cache data valid", booleanString(pipelineCacheDataCompatible(lastCacheData, context.getProperties())));
+    printLn("Compute pipelines", computeVariantCount);
+    printLn("Graphics pipelines", graphicsVariantCount);
+    printEndLn();
+    std::cout << "Pipelines/s" << std::endl;
+    printRow({"Threads", "No cache", "Cold cache", "Warm cache", "Efficiency", "Cache speedup"});
+    const double singleThreadRate = pipelineCount / (results.front().noCache.median / 1e3);
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const PipelineCreationResult& result = results[i];
+        const std::string path = "threads=" + std::to_string(threadCounts[i]) + "/";
+        recordResult(path + "no cache", result.noCache);
+        recordResult(path + "cold cache", result.coldCache);
+        recordResult(path + "warm cache", result.warmCache);
+        const double noCacheRate = pipelineCount / (result.noCache.median / 1e3);
+        printRow({
+            std::to_string(threadCounts[i]),
+            fixedString(noCacheRate, 1),
+            fixedString(pipelineCount / (result.coldCache.median / 1e3), 1),
+            fixedString(pipelineCount / (result.warmCache.median / 1e3), 1),
+            fixedString(noCacheRate / (singleThreadRate * threadCounts[i]) * 100., 1) + "%",
+            fixedString(result.coldCache.median / result.warmCache.median, 2) + "x"});
+    }
+}
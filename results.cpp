@@ -0,0 +1,273 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include "results.h"
+
+// "vendorID:deviceID" part of fingerprint
+static std::string deviceOf(const std::string& fingerprint)
+{
+    const std::size_t separator = fingerprint.find(':');
+    return fingerprint.substr(0, (std::string::npos == separator) ? separator : fingerprint.find(':', separator + 1));
+}
+
+// FNV-1a of device, so that results of all drivers are found by one lookup
+static uint64_t deviceKey(const std::string& fingerprint) noexcept
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : deviceOf(fingerprint))
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string jsonString(const std::string& str)
+{
+    std::string json = "\"";
+    for (char c : str)
+    {
+        if (('"' == c) || ('\\' == c))
+            json += '\\';
+        json += c;
+    }
+    return json + "\"";
+}
+
+std::string serializeRecord(const ResultRecord& record)
+{
+    const Timing& timing = record.timing;
+    std::ostringstream json;
+    json.precision(17);
+    json << "{\"fingerprint\":" << jsonString(record.fingerprint)
+        << ",\"time\":" << record.time
+        << ",\"benchmark\":" << jsonString(record.benchmark)
+        << ",\"metric\":" << jsonString(record.metric)
+        << ",\"median\":" << timing.median
+        << ",\"mean\":" << timing.mean
+        << ",\"mad\":" << timing.mad
+        << ",\"standardDeviation\":" << timing.standardDeviation
+        << ",\"min\":" << timing.min
+        << ",\"max\":" << timing.max
+        << ",\"p99\":" << timing.p99
+        << ",\"sampleCount\":" << timing.sampleCount
+        << ",\"outlierCount\":" << timing.outlierCount
+        << ",\"warmupCount\":" << timing.warmupCount
+        << "}";
+    return json.str();
+}
+
+// Returns raw value of field: unescaped string or number literal
+static bool findField(const std::string& line, const char *name, std::string& value)
+{
+    const std::string key = std::string("\"") + name + "\":";
+    std::size_t pos = line.find(key);
+    if (std::string::npos == pos)
+        return false;
+    pos += key.size();
+    value.clear();
+    if (pos < line.size() && '"' == line[pos])
+    {
+        for (++pos; pos < line.size() && line[pos] != '"'; ++pos)
+        {
+            if ('\\' == line[pos])
+                ++pos;
+            if (pos < line.size())
+                value += line[pos];
+        }
+        return pos < line.size();
+    }
+    const std::size_t end = line.find_first_of(",}", pos);
+    if (std::string::npos == end)
+        return false;
+    value = line.substr(pos, end - pos);
+    return !value.empty();
+}
+
+bool parseRecord(const std::string& line, ResultRecord& record)
+{
+    std::string value;
+    auto number = [&](const char *name, double& field)
+    {
+        if (!findField(line, name, value))
+            return false;
+        field = std::strtod(value.c_str(), nullptr);
+        return true;
+    };
+    auto count = [&](const char *name, uint32_t& field)
+    {
+        if (!findField(line, name, value))
+            return false;
+        field = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        return true;
+    };
+    Timing& timing = record.timing;
+    if (!findField(line, "fingerprint", record.fingerprint) ||
+        !findField(line, "benchmark", record.benchmark) ||
+        !findField(line, "metric", record.metric) ||
+        !findField(line, "time", value))
+        return false;
+    record.time = std::strtoll(value.c_str(), nullptr, 10);
+    return number("median", timing.median) &&
+        number("mean", timing.mean) &&
+        number("mad", timing.mad) &&
+        number("standardDeviation", timing.standardDeviation) &&
+        number("min", timing.min) &&
+        number("max", timing.max) &&
+        number("p99", timing.p99) &&
+        count("sampleCount", timing.sampleCount) &&
+        count("outlierCount", timing.outlierCount) &&
+        count("warmupCount", timing.warmupCount);
+}
+
+ResultStore::ResultStore(const std::string& fileName):
+    dataFileName(fileName),
+    indexFileName(fileName + ".idx")
+{
+    loadIndex();
+}
+
+void ResultStore::append(const std::vector<ResultRecord>& records)
+{
+    std::string lines;
+    std::vector<IndexEntry> entries;
+    for (const auto& record : records)
+    {
+        entries.push_back({deviceKey(record.fingerprint), dataSize + lines.size()});
+        lines += serializeRecord(record) + "\n";
+    }
+    std::ofstream data(dataFileName, std::ios::binary | std::ios::app);
+    if (!data.write(lines.data(), lines.size()).flush())
+        throw std::runtime_error("failed to write " + dataFileName);
+    dataSize += lines.size();
+    insert(entries);
+}
+
+std::vector<ResultRecord> ResultStore::find(const std::string& fingerprint) const
+{
+    return findRecords(fingerprint, false);
+}
+
+std::vector<ResultRecord> ResultStore::findDevice(const std::string& fingerprint) const
+{
+    return findRecords(fingerprint, true);
+}
+
+std::vector<ResultRecord> ResultStore::findRecords(const std::string& fingerprint, bool anyDriver) const
+{
+    const uint64_t key = deviceKey(fingerprint);
+    const std::string device = deviceOf(fingerprint);
+    const auto range = std::equal_range(index.begin(), index.end(), IndexEntry{key, 0},
+        [](const IndexEntry& a, const IndexEntry& b) { return a.key < b.key; });
+    std::vector<ResultRecord> records;
+    if (range.first == range.second)
+        return records;
+    std::ifstream data(dataFileName, std::ios::binary);
+    std::string line;
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        data.clear();
+        data.seekg(it->offset);
+        ResultRecord record;
+        if (!std::getline(data, line) || !parseRecord(line, record))
+            continue;
+        // Hash collision is resolved by comparison of device or full fingerprint
+        if (anyDriver ? deviceOf(record.fingerprint) == device : record.fingerprint == fingerprint)
+            records.push_back(std::move(record));
+    }
+    return records;
+}
+
+// Index written with different key is rebuilt
+bool ResultStore::validKey(const IndexEntry& entry) const
+{
+    std::ifstream data(dataFileName, std::ios::binary);
+    data.seekg(entry.offset);
+    std::string line;
+    ResultRecord record;
+    return std::getline(data, line) && parseRecord(line, record) && deviceKey(record.fingerprint) == entry.key;
+}
+
+void ResultStore::loadIndex()
+{
+    std::ifstream data(dataFileName, std::ios::binary | std::ios::ate);
+    std::ifstream indexFile(indexFileName, std::ios::binary | std::ios::ate);
+    const std::size_t indexSize = indexFile ? static_cast<std::size_t>(indexFile.tellg()) : 0;
+    if (data)
+    {
+        dataSize = static_cast<uint64_t>(data.tellg());
+        char last = '\n';
+        if (dataSize)
+            data.seekg(-1, std::ios::end).get(last);
+        data.close();
+        if (last != '\n')
+        {   // Torn record at the end is terminated, so that next record starts on its own line
+            std::ofstream terminate(dataFileName, std::ios::binary | std::ios::app);
+            if (!terminate.put('\n').flush())
+                throw std::runtime_error("failed to write " + dataFileName);
+            ++dataSize;
+        }
+    }
+    if (indexFile)
+    {   // Partially written entry at the end is dropped
+        const std::size_t entryCount = indexSize / sizeof(IndexEntry);
+        index.resize(entryCount);
+        indexFile.seekg(0);
+        indexFile.read(reinterpret_cast<char *>(index.data()), entryCount * sizeof(IndexEntry));
+        index.erase(std::remove_if(index.begin(), index.end(),
+            [this](const IndexEntry& entry) { return entry.offset >= dataSize; }), index.end());
+        indexFile.close();
+        if (!index.empty() && !validKey(index.front()))
+            index.clear();
+    }
+    if (index.size() * sizeof(IndexEntry) != indexSize)
+    {   // Index file is rewritten with valid entries only, otherwise appended entries would be misaligned
+        std::ofstream rewrite(indexFileName, std::ios::binary | std::ios::trunc);
+        if (!rewrite.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(IndexEntry)).flush())
+            throw std::runtime_error("failed to write " + indexFileName);
+    }
+    if (!dataSize)
+        return;
+    // Records appended after last indexed one are missing in index
+    uint64_t lastOffset = 0;
+    for (const auto& entry : index)
+        lastOffset = std::max(lastOffset, entry.offset);
+    std::sort(index.begin(), index.end(), indexOrder);
+    indexFrom(lastOffset, !index.empty());
+}
+
+void ResultStore::indexFrom(uint64_t offset, bool skipFirst)
+{
+    std::ifstream data(dataFileName, std::ios::binary);
+    data.seekg(offset);
+    std::string line;
+    if (skipFirst)
+    {
+        std::getline(data, line);
+        offset += line.size() + 1;
+    }
+    std::vector<IndexEntry> entries;
+    while (std::getline(data, line))
+    {
+        ResultRecord record;
+        if (!data.eof() && parseRecord(line, record)) // Incomplete line isn't indexed
+            entries.push_back({deviceKey(record.fingerprint), offset});
+        offset += line.size() + 1;
+    }
+    if (entries.empty())
+        return;
+    insert(entries);
+}
+
+// Index is written after data, so that interrupted append is recovered by reindexing
+void ResultStore::insert(const std::vector<IndexEntry>& entries)
+{
+    std::ofstream indexFile(indexFileName, std::ios::binary | std::ios::app);
+    indexFile.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(IndexEntry));
+    const std::size_t middle = index.size();
+    index.insert(index.end(), entries.begin(), entries.end());
+    std::sort(index.begin() + middle, index.end(), indexOrder);
+    std::inplace_merge(index.begin(), index.begin() + middle, index.end(), indexOrder);
+}
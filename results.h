@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "statistics.h"
+
+// One measured metric of benchmark run
+struct ResultRecord
+{
+    std::string fingerprint;
+    int64_t time = 0; // Seconds since epoch
+    std::string benchmark;
+    std::string metric;
+    Timing timing;
+};
+
+// Append-only results store. Records are JSON lines in data file;
+// binary index file next to it maps device hash to record offset,
+// so that lookup reads only records of the given device.
+// Fingerprint starts with "vendorID:deviceID:", see DeviceFingerprint.
+class ResultStore
+{
+public:
+    explicit ResultStore(const std::string& fileName);
+    void append(const std::vector<ResultRecord>& records);
+    // Records with the same fingerprint
+    std::vector<ResultRecord> find(const std::string& fingerprint) const;
+    // Records of the same device with any driver
+    std::vector<ResultRecord> findDevice(const std::string& fingerprint) const;
+    std::size_t getRecordCount() const noexcept { return index.size(); }
+
+private:
+    struct IndexEntry
+    {
+        uint64_t key;
+        uint64_t offset;
+    };
+
+    static bool indexOrder(const IndexEntry& a, const IndexEntry& b) noexcept
+        { return a.key < b.key || (a.key == b.key && a.offset < b.offset); }
+    std::vector<ResultRecord> findRecords(const std::string& fingerprint, bool anyDriver) const;
+    bool validKey(const IndexEntry& entry) const;
+    void loadIndex();
+    void indexFrom(uint64_t offset, bool skipFirst);
+    void insert(const std::vector<IndexEntry>& entries);
+
+    std::string dataFileName;
+    std::string indexFileName;
+    uint64_t dataSize = 0;
+    std::vector<IndexEntry> index; // Sorted by key and offset
+};
+
+std::string jsonString(const std::string& str);
+std::string serializeRecord(const ResultRecord& record);
+// Returns false if line is not a valid record
+bool parseRecord(const std::string& line, ResultRecord& record);
@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) out vec2 oTexCoord;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    oTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(oTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
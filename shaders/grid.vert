@@ -0,0 +1,23 @@
+#version 450
+
+// Grid of rotated triangles, so that edges cross pixels at various angles
+const int cellsPerSide = 64;
+
+layout(location = 0) out vec2 oTexCoord;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    const int cell = gl_VertexIndex / 3;
+    const int corner = gl_VertexIndex % 3;
+    const vec2 center = (vec2(cell % cellsPerSide, cell / cellsPerSide) + 0.5) / float(cellsPerSide);
+    // Golden angle per cell and layer, 120 degrees per corner
+    const float angle = float(cell + gl_InstanceIndex * 7) * 2.39996 + float(corner) * 2.09440;
+    const vec2 position = center + vec2(cos(angle), sin(angle)) * (0.75 / float(cellsPerSide));
+    oTexCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, float((cell + gl_InstanceIndex) % 8) / 8.0, 1.0);
+}
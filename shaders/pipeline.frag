@@ -0,0 +1,15 @@
+#version 450
+
+layout(constant_id = 0) const int iterations = 16;
+layout(constant_id = 1) const float scale = 1.0;
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 oColor;
+
+void main()
+{
+    vec4 v = vec4(texCoord, 0.0, 1.0);
+    for (int k = 0; k < iterations; ++k)
+        v = fract(sin(v * scale + float(k)) * 43758.5453);
+    oColor = v;
+}
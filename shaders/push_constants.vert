@@ -0,0 +1,20 @@
+#version 450
+
+layout(push_constant) uniform PushConstants
+{
+    mat4 transform;
+};
+
+layout(location = 0) out vec2 oTexCoord;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+// Fullscreen triangle with per-draw transform
+void main()
+{
+    oTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = transform * vec4(oTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,97 @@
+// Workgroup reduction and inclusive prefix scan. Including shader either defines
+// SHARED_MEMORY or provides reduceSubgroup() and scanSubgroup() built on one class
+// of subgroup operations. REDUCE_ONLY leaves scan out.
+
+layout(local_size_x_id = 0) in;
+layout(constant_id = 1) const bool scan = false;
+
+layout(binding = 0) readonly buffer Input
+{
+    uint values[];
+};
+
+layout(binding = 1) writeonly buffer Output
+{
+    uint results[];
+};
+
+shared uint partials[gl_WorkGroupSize.x];
+
+#ifdef SHARED_MEMORY
+// Tree reduction, result in first invocation
+uint reduceWorkgroup(uint value)
+{
+    const uint i = gl_LocalInvocationIndex;
+    partials[i] = value;
+    barrier();
+    for (uint stride = gl_WorkGroupSize.x/2; stride > 0; stride >>= 1)
+    {
+        if (i < stride)
+            partials[i] += partials[i + stride];
+        barrier();
+    }
+    return partials[0];
+}
+
+// Hillis-Steele scan
+uint scanWorkgroup(uint value)
+{
+    const uint i = gl_LocalInvocationIndex;
+    partials[i] = value;
+    barrier();
+    for (uint offset = 1; offset < gl_WorkGroupSize.x; offset <<= 1)
+    {
+        const uint sum = (i >= offset) ? partials[i - offset] : 0;
+        barrier();
+        partials[i] += sum;
+        barrier();
+    }
+    return partials[i];
+}
+#else
+// Subgroup sums are reduced by first subgroup, result in first invocation
+uint reduceWorkgroup(uint value)
+{
+    const uint sum = reduceSubgroup(value);
+    if (gl_SubgroupInvocationID == 0)
+        partials[gl_SubgroupID] = sum;
+    barrier();
+    uint total = 0;
+    if (gl_SubgroupID == 0)
+    {
+        for (uint i = gl_SubgroupInvocationID; i < gl_NumSubgroups; i += gl_SubgroupSize)
+            total += partials[i];
+        total = reduceSubgroup(total);
+    }
+    return total;
+}
+
+#ifndef REDUCE_ONLY
+// Every invocation adds totals of preceding subgroups
+uint scanWorkgroup(uint value)
+{
+    uint sum = scanSubgroup(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1)
+        partials[gl_SubgroupID] = sum;
+    barrier();
+    for (uint i = 0; i < gl_SubgroupID; ++i)
+        sum += partials[i];
+    return sum;
+}
+#endif // !REDUCE_ONLY
+#endif // SHARED_MEMORY
+
+void main()
+{
+    const uint value = values[gl_GlobalInvocationID.x];
+#ifndef REDUCE_ONLY
+    if (scan)
+    {
+        results[gl_GlobalInvocationID.x] = scanWorkgroup(value);
+        return;
+    }
+#endif
+    const uint sum = reduceWorkgroup(value);
+    if (gl_LocalInvocationIndex == 0)
+        results[gl_WorkGroupID.x] = sum;
+}
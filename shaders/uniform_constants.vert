@@ -0,0 +1,21 @@
+#version 450
+
+// Either uniform buffer or inline uniform block
+layout(binding = 0) uniform Uniforms
+{
+    mat4 transform;
+};
+
+layout(location = 0) out vec2 oTexCoord;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+// Fullscreen triangle with per-draw transform
+void main()
+{
+    oTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = transform * vec4(oTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,230 @@
+#include "gpucaps.h"
+#include "benchmark.h"
+
+static const VkDeviceSize maxMemorySize = 256 * 1024 * 1024;
+static const uint32_t maxBindCount = 4096;
+static const uint32_t maxTilesPerSide = 64;
+static const uint32_t repeatCount = 100;
+
+struct BindResult
+{
+    uint32_t bindCount;
+    Timing bind;
+    Timing unbind;
+};
+
+// Alternates binding and unbinding of the same pages, waits for fence after each operation
+template<typename Bind>
+static BindResult measureBindUnbind(const DeviceContext& context, VkQueue queue, VkFence fence,
+    const VkBindSparseInfo& bindInfo, const Bind *& pBinds, uint32_t& bindCount,
+    const std::vector<Bind>& binds, const std::vector<Bind>& unbinds)
+{
+    auto bindSparse = [&](const std::vector<Bind>& memoryBinds)
+    {
+        pBinds = memoryBinds.data();
+        const auto begin = Clock::now();
+        checkResult(vkQueueBindSparse(queue, 1, &bindInfo, fence), "vkQueueBindSparse");
+        context.waitAndReset(fence);
+        return elapsedMilliseconds(begin, Clock::now());
+    };
+    bindCount = static_cast<uint32_t>(binds.size());
+    std::vector<double> bindSamples, unbindSamples;
+    for (uint32_t i = 0; i < repeatCount; ++i)
+    {
+        bindSamples.push_back(bindSparse(binds));
+        unbindSamples.push_back(bindSparse(unbinds));
+    }
+    BindResult result;
+    result.bindCount = bindCount;
+    result.bind = summarize(std::move(bindSamples));
+    result.unbind = summarize(std::move(unbindSamples));
+    return result;
+}
+
+// Powers of 4 up to and including the whole resource
+static std::vector<uint32_t> bindCountSweep(uint32_t maxCount)
+{
+    std::vector<uint32_t> bindCounts;
+    for (uint32_t bindCount = 1; bindCount < maxCount; bindCount *= 4)
+        bindCounts.push_back(bindCount);
+    bindCounts.push_back(maxCount);
+    return bindCounts;
+}
+
+static DeviceMemory allocateMemory(const DeviceContext& context, VkDeviceSize size, uint32_t memoryTypeBits)
+{
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = context.findMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (UINT32_MAX == allocInfo.memoryTypeIndex)
+        throw BenchmarkSkipped("no device local memory type for sparse resource");
+    VkDeviceMemory memory;
+    checkResult(vkAllocateMemory(context.getDevice(), &allocInfo, nullptr, &memory), "vkAllocateMemory");
+    return DeviceMemory(context.getDevice(), memory);
+}
+
+static std::vector<BindResult> benchmarkSparseBuffer(const DeviceContext& context, VkQueue queue, VkFence fence)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.flags = VK_BUFFER_CREATE_SPARSE_BINDING_BIT;
+    bufferInfo.size = maxMemorySize;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer handle;
+    checkResult(vkCreateBuffer(context.getDevice(), &bufferInfo, nullptr, &handle), "vkCreateBuffer");
+    BufferHandle buffer(context.getDevice(), handle);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(context.getDevice(), buffer, &memoryRequirements);
+    // Alignment is the sparse block size
+    const VkDeviceSize pageSize = memoryRequirements.alignment;
+    const uint32_t pageCount = static_cast<uint32_t>(std::min<VkDeviceSize>(maxBindCount, maxMemorySize / pageSize));
+    DeviceMemory memory = allocateMemory(context, pageCount * pageSize, memoryRequirements.memoryTypeBits);
+    VkSparseBufferMemoryBindInfo bufferBindInfo = {buffer, 0, nullptr};
+    VkBindSparseInfo bindInfo = {};
+    bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bindInfo.bufferBindCount = 1;
+    bindInfo.pBufferBinds = &bufferBindInfo;
+    std::vector<BindResult> results;
+    for (uint32_t bindCount : bindCountSweep(pageCount))
+    {
+        std::vector<VkSparseMemoryBind> binds(bindCount), unbinds(bindCount);
+        for (uint32_t i = 0; i < bindCount; ++i)
+        {
+            binds[i] = {i * pageSize, pageSize, memory, i * pageSize, 0};
+            unbinds[i] = {i * pageSize, pageSize, VK_NULL_HANDLE, 0, 0};
+        }
+        results.push_back(measureBindUnbind(context, queue, fence, bindInfo,
+            bufferBindInfo.pBinds, bufferBindInfo.bindCount, binds, unbinds));
+    }
+    return results;
+}
+
+static std::vector<BindResult> benchmarkSparseImage(const DeviceContext& context, VkQueue queue, VkFence fence)
+{
+    const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    uint32_t propertyCount = 0;
+    vkGetPhysicalDeviceSparseImageFormatProperties(context.getPhysicalDevice(), format, VK_IMAGE_TYPE_2D,
+        VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_TILING_OPTIMAL, &propertyCount, nullptr);
+    if (!propertyCount)
+        throw BenchmarkSkipped("sparse RGBA8 images not supported");
+    std::vector<VkSparseImageFormatProperties> formatProperties(propertyCount);
+    vkGetPhysicalDeviceSparseImageFormatProperties(context.getPhysicalDevice(), format, VK_IMAGE_TYPE_2D,
+        VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_TILING_OPTIMAL, &propertyCount, formatProperties.data());
+    const VkExtent3D granularity = formatProperties[0].imageGranularity;
+    const uint32_t maxImageDimension = context.getLimits().maxImageDimension2D;
+    const uint32_t tilesPerSide = std::min({maxTilesPerSide,
+        maxImageDimension / granularity.width, maxImageDimension / granularity.height});
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = {tilesPerSide * granularity.width, tilesPerSide * granularity.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImage handle;
+    checkResult(vkCreateImage(context.getDevice(), &imageInfo, nullptr, &handle), "vkCreateImage");
+    ImageHandle image(context.getDevice(), handle);
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(context.getDevice(), image, &memoryRequirements);
+    const VkDeviceSize tileSize = memoryRequirements.alignment;
+    const uint32_t tileCount = tilesPerSide * tilesPerSide;
+    DeviceMemory memory = allocateMemory(context, tileCount * tileSize, memoryRequirements.memoryTypeBits);
+    VkSparseImageMemoryBindInfo imageBindInfo = {image, 0, nullptr};
+    VkBindSparseInfo bindInfo = {};
+    bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bindInfo.imageBindCount = 1;
+    bindInfo.pImageBinds = &imageBindInfo;
+    std::vector<BindResult> results;
+    for (uint32_t bindCount : bindCountSweep(tileCount))
+    {
+        std::vector<VkSparseImageMemoryBind> binds(bindCount), unbinds(bindCount);
+        for (uint32_t i = 0; i < bindCount; ++i)
+        {
+            VkSparseImageMemoryBind& bind = binds[i];
+            bind.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
+            bind.offset = {
+                static_cast<int32_t>(i % tilesPerSide * granularity.width),
+                static_cast<int32_t>(i / tilesPerSide * granularity.height), 0};
+            bind.extent = granularity;
+            bind.memory = memory;
+            bind.memoryOffset = i * tileSize;
+            bind.flags = 0;
+            unbinds[i] = bind;
+            unbinds[i].memory = VK_NULL_HANDLE;
+            unbinds[i].memoryOffset = 0;
+        }
+        results.push_back(measureBindUnbind(context, queue, fence, bindInfo,
+            imageBindInfo.pBinds, imageBindInfo.bindCount, binds, unbinds));
+    }
+    return results;
+}
+
+static void printBindResults(const std::vector<BindResult>& results, const std::string& path)
+{
+    // Every bind is a single page or tile
+    printRow({"Binds", "Bind p50, us", "Bind p99, us", "Unbind p50, us", "Unbind p99, us", "Bind, pages/s"});
+    for (const auto& result : results)
+    {
+        recordResult(path + "binds=" + std::to_string(result.bindCount) + "/bind", result.bind);
+        recordResult(path + "binds=" + std::to_string(result.bindCount) + "/unbind", result.unbind);
+        printRow({
+            std::to_string(result.bindCount),
+            fixedString(result.bind.median * 1e3, 1),
+            fixedString(result.bind.p99 * 1e3, 1),
+            fixedString(result.unbind.median * 1e3, 1),
+            fixedString(result.unbind.p99 * 1e3, 1),
+            fixedString(result.bindCount / (result.bind.median / 1e3), 0)});
+    }
+}
+
+void benchmarkSparseBinding(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice->getHandle(), &features);
+    if (!features.sparseBinding)
+        throw BenchmarkSkipped("sparse binding not supported");
+    DeviceOptions options;
+    options.features.sparseBinding = VK_TRUE;
+    options.features.sparseResidencyImage2D = features.sparseResidencyImage2D;
+    DeviceContext context(physicalDevice->getHandle(), options);
+    Fence fence = context.createFence();
+    const std::vector<VkQueueFamilyProperties>& queueFamilies = context.getQueueFamilies();
+    setFieldWidth(30);
+    for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilies.size(); ++queueFamilyIndex)
+    {
+        const VkQueueFamilyProperties& queueFamily = queueFamilies[queueFamilyIndex];
+        if (!(queueFamily.queueFlags & VK_QUEUE_SPARSE_BINDING_BIT))
+            continue;
+        const VkQueue queue = context.getQueue(queueFamilyIndex);
+        printEndLn();
+        std::cout << "#" << queueFamilyIndex << " " << queueFlagsString(queueFamily.queueFlags) << std::endl;
+        printEndLn();
+        std::cout << "Buffer pages" << std::endl;
+        const std::string path = "queue family=" + std::to_string(queueFamilyIndex) + "/";
+        printBindResults(benchmarkSparseBuffer(context, queue, fence), path + "buffer/");
+        printEndLn();
+        std::cout << "2D image tiles" << std::endl;
+        if (!features.sparseResidencyImage2D)
+            std::cout << "Not supported" << std::endl;
+        else
+        {
+            try
+            {
+                printBindResults(benchmarkSparseImage(context, queue, fence), path + "image/");
+            }
+            catch (const BenchmarkSkipped& skipped)
+            {
+                std::cout << "Skipped: " << skipped.what() << std::endl;
+            }
+        }
+    }
+}
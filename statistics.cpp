@@ -0,0 +1,338 @@
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "statistics.h"
+
+MeasurementPolicy measurementPolicy;
+
+// Expects sorted samples
+static double sortedMedian(const std::vector<double>& samples) noexcept
+{
+    const std::size_t middle = samples.size()/2;
+    return (samples.size() % 2) ? samples[middle] : (samples[middle - 1] + samples[middle]) * .5;
+}
+
+static double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return sortedMedian(samples);
+}
+
+// Two-sided 95% quantile of Student's t-distribution
+static double studentT95(std::size_t degreesOfFreedom) noexcept
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    const std::size_t tableSize = sizeof(table)/sizeof(table[0]);
+    if (!degreesOfFreedom)
+        return 0.;
+    return degreesOfFreedom <= tableSize ? table[degreesOfFreedom - 1] : 1.96;
+}
+
+// Modified z-score of Iglewicz and Hoaglin; nothing is rejected if more than half of samples are equal
+static std::vector<bool> findOutliers(const std::vector<double>& samples, double outlierThreshold)
+{
+    std::vector<bool> outliers(samples.size(), false);
+    if (samples.empty())
+        return outliers;
+    const double center = median(samples);
+    std::vector<double> deviations;
+    deviations.reserve(samples.size());
+    for (double sample : samples)
+        deviations.push_back(std::fabs(sample - center));
+    const double mad = median(std::move(deviations));
+    if (mad > 0.)
+    {
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            outliers[i] = .6745 * std::fabs(samples[i] - center) / mad > outlierThreshold;
+    }
+    return outliers;
+}
+
+// Central values are computed from samples that aren't outliers, range and tail from all samples
+static Timing summarizeSelected(std::vector<double> samples, const std::vector<bool>& outliers)
+{
+    Timing timing;
+    if (samples.empty())
+        return timing;
+    std::vector<double> kept;
+    kept.reserve(samples.size());
+    for (std::size_t i = 0; i < samples.size(); ++i)
+    {
+        if (!outliers[i])
+            kept.push_back(samples[i]);
+    }
+    timing.outlierCount = static_cast<uint32_t>(samples.size() - kept.size());
+    std::sort(samples.begin(), samples.end());
+    timing.min = samples.front();
+    timing.max = samples.back();
+    // Nearest rank
+    const std::size_t rank = static_cast<std::size_t>(std::ceil(samples.size() * .99));
+    timing.p99 = samples[std::max<std::size_t>(rank, 1) - 1];
+    const double center = sortedMedian(samples);
+    std::vector<double> deviations;
+    deviations.reserve(samples.size());
+    for (double sample : samples)
+        deviations.push_back(std::fabs(sample - center));
+    timing.mad = median(std::move(deviations));
+    const std::size_t n = kept.size();
+    if (!n)
+        return timing;
+    std::sort(kept.begin(), kept.end());
+    timing.median = sortedMedian(kept);
+    double sum = 0.;
+    for (double sample : kept)
+        sum += sample;
+    timing.mean = sum / n;
+    if (n > 1)
+    {
+        double sumSquares = 0.;
+        for (double sample : kept)
+            sumSquares += (sample - timing.mean) * (sample - timing.mean);
+        timing.standardDeviation = std::sqrt(sumSquares / (n - 1));
+        timing.confidence = studentT95(n - 1) * timing.standardDeviation / std::sqrt(static_cast<double>(n));
+    }
+    timing.sampleCount = static_cast<uint32_t>(n);
+    return timing;
+}
+
+Timing summarize(std::vector<double> samples, double outlierThreshold)
+{
+    const std::vector<bool> outliers = findOutliers(samples, outlierThreshold);
+    return summarizeSelected(std::move(samples), outliers);
+}
+
+std::vector<Timing> summarizePaired(const std::vector<std::vector<double>>& series, uint32_t warmupCount, double outlierThreshold)
+{
+    std::vector<Timing> timings;
+    if (series.empty())
+        return timings;
+    const auto steadySamples = [warmupCount](const std::vector<double>& samples)
+    {
+        return std::vector<double>(samples.begin() + std::min<std::size_t>(warmupCount, samples.size()), samples.end());
+    };
+    const std::vector<bool> outliers = findOutliers(steadySamples(series.front()), outlierThreshold);
+    for (const auto& samples : series)
+    {
+        Timing timing = summarizeSelected(steadySamples(samples), outliers);
+        timing.warmupCount = warmupCount;
+        timings.push_back(timing);
+    }
+    return timings;
+}
+
+Timing combine(const std::vector<Timing>& timings)
+{
+    Timing pooled;
+    std::vector<double> medians;
+    double sum = 0.;
+    for (const auto& timing : timings)
+    {
+        if (!timing.sampleCount)
+            continue;
+        if (!pooled.sampleCount || timing.min < pooled.min)
+            pooled.min = timing.min;
+        pooled.max = std::max(pooled.max, timing.max);
+        pooled.p99 = std::max(pooled.p99, timing.p99);
+        pooled.sampleCount += timing.sampleCount;
+        pooled.outlierCount += timing.outlierCount;
+        sum += timing.mean * timing.sampleCount;
+        medians.push_back(timing.median);
+    }
+    if (!pooled.sampleCount)
+        return pooled;
+    const std::size_t n = pooled.sampleCount;
+    pooled.mean = sum / n;
+    pooled.median = median(std::move(medians)); // Median of run medians
+    // Within-run and between-run variance
+    double sumSquares = 0.;
+    for (const auto& timing : timings)
+    {
+        const double deviation = timing.mean - pooled.mean;
+        sumSquares += (timing.sampleCount - 1.) * timing.standardDeviation * timing.standardDeviation +
+            timing.sampleCount * deviation * deviation;
+    }
+    if (n > 1)
+    {
+        pooled.standardDeviation = std::sqrt(std::max(sumSquares, 0.) / (n - 1));
+        pooled.confidence = studentT95(n - 1) * pooled.standardDeviation / std::sqrt(static_cast<double>(n));
+    }
+    return pooled;
+}
+
+bool significantlySlower(const Timing& baseline, const Timing& current, double minRelativeChange)
+{
+    if (baseline.sampleCount < 2 || current.sampleCount < 2)
+        return false;
+    const double difference = current.mean - baseline.mean;
+    if (difference <= baseline.mean * minRelativeChange)
+        return false;
+    const double baselineVariance = baseline.standardDeviation * baseline.standardDeviation / baseline.sampleCount;
+    const double currentVariance = current.standardDeviation * current.standardDeviation / current.sampleCount;
+    const double variance = baselineVariance + currentVariance;
+    if (variance <= 0.)
+        return true; // Both are exact and differ
+    // Welch-Satterthwaite degrees of freedom
+    const double degreesOfFreedom = variance * variance /
+        (baselineVariance * baselineVariance / (baseline.sampleCount - 1) +
+         currentVariance * currentVariance / (current.sampleCount - 1));
+    const double t = difference / std::sqrt(variance);
+    return t > studentT95(static_cast<std::size_t>(std::max(degreesOfFreedom, 1.)));
+}
+
+uint32_t detectWarmup(const std::vector<double>& samples, double tolerance, uint32_t maxWarmupCount)
+{
+    // Need enough samples to tell steady state
+    if (samples.size() < 4)
+        return 0;
+    const std::size_t half = samples.size()/2;
+    const double steadyState = median(std::vector<double>(samples.begin() + half, samples.end()));
+    const std::size_t maxCount = std::min<std::size_t>(maxWarmupCount, half);
+    uint32_t warmupCount = 0;
+    while (warmupCount < maxCount && samples[warmupCount] > steadyState * (1. + tolerance))
+        ++warmupCount;
+    return warmupCount;
+}
+
+// Sampling loop shared by single and paired measurements
+static std::vector<Timing> measureSeries(uint32_t sampleCount, const std::function<std::vector<double>()>& sample,
+    bool adaptive, const MeasurementPolicy& policy)
+{
+    const uint32_t maxSampleCount = adaptive ? std::max(policy.maxSampleCount, sampleCount + policy.maxWarmupCount) : sampleCount;
+    const auto begin = Clock::now();
+    std::vector<std::vector<double>> series;
+    uint32_t warmupCount = 0;
+    do
+    {
+        const std::vector<double> values = sample();
+        series.resize(values.size());
+        for (std::size_t i = 0; i < values.size(); ++i)
+            series[i].push_back(values[i]);
+        const std::vector<double>& samples = series.front();
+        if (!adaptive)
+            continue;
+        warmupCount = detectWarmup(samples, policy.warmupTolerance, policy.maxWarmupCount);
+        if (samples.size() - warmupCount < sampleCount && samples.size() < maxSampleCount)
+            continue;
+        const Timing timing = summarize(std::vector<double>(samples.begin() + warmupCount, samples.end()), policy.outlierThreshold);
+        if (timing.relativeConfidence() <= policy.targetConfidence ||
+            elapsedMilliseconds(begin, Clock::now()) >= policy.timeBudget)
+            break;
+    } while (series.front().size() < maxSampleCount);
+    if (!adaptive)
+        warmupCount = detectWarmup(series.front(), policy.warmupTolerance, policy.maxWarmupCount);
+    return summarizePaired(series, warmupCount, policy.outlierThreshold);
+}
+
+Timing measureFixed(uint32_t sampleCount, const std::function<double()>& sample, const MeasurementPolicy& policy)
+{
+    return measureSeries(sampleCount, [&sample]() { return std::vector<double>(1, sample()); }, false, policy).front();
+}
+
+Timing measureAdaptive(uint32_t minSampleCount, const std::function<double()>& sample, const MeasurementPolicy& policy)
+{
+    return measureSeries(minSampleCount, [&sample]() { return std::vector<double>(1, sample()); }, true, policy).front();
+}
+
+std::vector<Timing> measurePaired(uint32_t sampleCount, const std::function<std::vector<double>()>& sample,
+    const MeasurementPolicy& policy)
+{
+    return measureSeries(sampleCount, sample, policy.adaptive, policy);
+}
+
+#ifdef __linux__
+// Affinity of thread before it was pinned
+static cpu_set_t unpinnedCpuSet;
+static bool pinned = false;
+#endif
+
+bool pinThreadToCpu(uint32_t cpuIndex)
+{
+#ifdef _WIN32
+    if (cpuIndex >= sizeof(DWORD_PTR) * 8)
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpuIndex) != 0;
+#elif defined(__linux__)
+    if (cpuIndex >= CPU_SETSIZE)
+        return false;
+    if (!pinned && pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &unpinnedCpuSet) != 0)
+        return false;
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpuIndex, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0)
+        return false;
+    pinned = true;
+    return true;
+#else
+    (void)cpuIndex;
+    return false;
+#endif
+}
+
+bool unpinThread()
+{
+#ifdef __linux__
+    if (!pinned)
+        return true;
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &unpinnedCpuSet) == 0;
+#else
+    // Windows threads start with affinity of process, not of their creator
+    return true;
+#endif
+}
+
+static std::string readLine(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+static uint32_t readKHz(const std::string& path)
+{
+    const std::string line = readLine(path);
+    return line.empty() ? 0 : static_cast<uint32_t>(std::strtoul(line.c_str(), nullptr, 10));
+}
+
+CpuFrequencyState readCpuFrequencyState(uint32_t cpuIndex)
+{
+    CpuFrequencyState state;
+#ifdef __linux__
+    const std::string cpufreq = "/sys/devices/system/cpu/cpu" + std::to_string(cpuIndex) + "/cpufreq/";
+    state.governor = readLine(cpufreq + "scaling_governor");
+    state.currentKHz = readKHz(cpufreq + "scaling_cur_freq");
+    state.minKHz = readKHz(cpufreq + "scaling_min_freq");
+    state.maxKHz = readKHz(cpufreq + "scaling_max_freq");
+#else
+    (void)cpuIndex;
+#endif
+    return state;
+}
+
+std::string DeviceFingerprint::toString() const
+{
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0')
+        << std::setw(4) << vendorID << ":"
+        << std::setw(4) << deviceID << ":"
+        << std::setw(8) << driverVersion << ":"
+        << std::dec << driverID << ":"
+        << (uint32_t)conformanceVersion[0] << "."
+        << (uint32_t)conformanceVersion[1] << "."
+        << (uint32_t)conformanceVersion[2] << "."
+        << (uint32_t)conformanceVersion[3];
+    return oss.str();
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+// Measurement statistics that don't depend on Vulkan, so they can be exercised with CPU workloads
+
+typedef std::chrono::steady_clock Clock;
+
+inline double elapsedMilliseconds(Clock::time_point begin, Clock::time_point end) noexcept
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// Summary of repeated measurements, in milliseconds.
+// Central values are computed after outlier rejection, range and tail from all samples.
+struct Timing
+{
+    double median = 0.;
+    double mean = 0.;
+    double mad = 0.; // Median absolute deviation
+    double standardDeviation = 0.;
+    double confidence = 0.; // Half-width of 95% confidence interval of the mean
+    double min = 0.;
+    double max = 0.;
+    double p99 = 0.; // 99th percentile
+    uint32_t sampleCount = 0; // Samples left after outlier rejection
+    uint32_t outlierCount = 0;
+    uint32_t warmupCount = 0; // Leading samples discarded as warmup
+
+    double relativeConfidence() const noexcept { return mean > 0. ? confidence / mean : 0.; }
+};
+
+// Controls warmup detection, outlier rejection and how long adaptive measurement goes on
+struct MeasurementPolicy
+{
+    bool adaptive = false; // Enabled with --adaptive, otherwise sample count is fixed by caller
+    uint32_t maxWarmupCount = 10;
+    double warmupTolerance = .1; // Sample is warm if within this fraction of steady state median
+    uint32_t maxSampleCount = 1000;
+    double targetConfidence = .02; // Relative half-width of confidence interval to stop at
+    double timeBudget = 10000.; // Milliseconds, only stops measurement after minimum count is reached
+    double outlierThreshold = 3.5; // Modified z-score above which sample is an outlier
+};
+
+extern MeasurementPolicy measurementPolicy;
+
+// Rejects outliers by median/MAD and summarizes the rest
+Timing summarize(std::vector<double> samples, double outlierThreshold = measurementPolicy.outlierThreshold);
+
+// Pools summaries of several runs of the same measurement into one
+Timing combine(const std::vector<Timing>& timings);
+
+// Welch's t-test at 95% confidence; changes smaller than <minRelativeChange> of baseline mean are ignored
+bool significantlySlower(const Timing& baseline, const Timing& current, double minRelativeChange);
+
+// Returns count of leading samples that are slower than steady state of the tail
+uint32_t detectWarmup(const std::vector<double>& samples, double tolerance, uint32_t maxWarmupCount);
+
+// Takes exactly <sampleCount> samples and drops leading warmup ones
+Timing measureFixed(uint32_t sampleCount, const std::function<double()>& sample,
+    const MeasurementPolicy& policy = measurementPolicy);
+
+// Takes samples until warmup is over and confidence interval is narrow enough,
+// but at least <minSampleCount> steady samples
+Timing measureAdaptive(uint32_t minSampleCount, const std::function<double()>& sample,
+    const MeasurementPolicy& policy = measurementPolicy);
+
+// Summarizes series of values that were sampled together, e.g. parts of one frame.
+// Warmup and outliers are those of the first series and are dropped from every series,
+// so that values derived from several series are computed over the same samples.
+std::vector<Timing> summarizePaired(const std::vector<std::vector<double>>& series, uint32_t warmupCount,
+    double outlierThreshold = measurementPolicy.outlierThreshold);
+
+// Calls function that returns values sampled together, first one drives warmup detection,
+// outlier rejection and adaptive stopping; returns timing of each value
+std::vector<Timing> measurePaired(uint32_t sampleCount, const std::function<std::vector<double>()>& sample,
+    const MeasurementPolicy& policy = measurementPolicy);
+
+// Calls function that returns its own sample (e.g. GPU time).
+// Sample count is fixed unless adaptive measurement is enabled by policy.
+template<typename Func>
+inline Timing measureSamples(uint32_t repeatCount, Func func)
+{
+    return measurementPolicy.adaptive ? measureAdaptive(repeatCount, func) : measureFixed(repeatCount, func);
+}
+
+// Measures CPU time of function call
+template<typename Func>
+inline Timing measure(uint32_t repeatCount, Func func)
+{
+    return measureSamples(repeatCount,
+        [&func]()
+        {
+            const auto begin = Clock::now();
+            func();
+            return elapsedMilliseconds(begin, Clock::now());
+        });
+}
+
+// Pins calling thread to logical CPU, returns false if not possible
+bool pinThreadToCpu(uint32_t cpuIndex);
+// Restores affinity that thread had before pinning. Linux threads inherit affinity
+// of their creator, so threads started by pinned thread call this to use all CPUs.
+bool unpinThread();
+
+// Frequency scaling state from sysfs; empty on platforms without cpufreq
+struct CpuFrequencyState
+{
+    std::string governor;
+    uint32_t currentKHz = 0;
+    uint32_t minKHz = 0;
+    uint32_t maxKHz = 0;
+};
+
+CpuFrequencyState readCpuFrequencyState(uint32_t cpuIndex);
+
+// Identifies device and driver that results belong to
+struct DeviceFingerprint
+{
+    uint32_t vendorID = 0;
+    uint32_t deviceID = 0;
+    uint32_t driverVersion = 0;
+    uint32_t driverID = 0; // Zero if VK_KHR_driver_properties is not supported
+    uint8_t conformanceVersion[4] = {}; // Major, minor, subminor, patch
+
+    std::string toString() const;
+};
@@ -0,0 +1,267 @@
+#include <cstddef>
+#include <cstring>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/reduction_shared.comp.h"
+#include "shaders/reduction_arithmetic.comp.h"
+#include "shaders/reduction_shuffle.comp.h"
+#include "shaders/reduction_shuffle_relative.comp.h"
+#include "shaders/reduction_clustered.comp.h"
+
+static const uint32_t maxElementCount = 8 * 1024 * 1024;
+static const uint32_t maxWorkgroupSize = 256;
+static const uint32_t repeatCount = 20;
+
+// Workgroup reduction strategy, built on one class of subgroup operations
+struct ReductionMethod
+{
+    const char *name;
+    VkSubgroupFeatureFlags requiredOperations; // Zero for shared memory
+    const uint32_t *code;
+    std::size_t size;
+    bool scan;
+};
+
+static const ReductionMethod reductionMethods[] = {
+    {"Shared memory", 0, reduction_shared_comp, sizeof(reduction_shared_comp), true},
+    {"Arithmetic", VK_SUBGROUP_FEATURE_ARITHMETIC_BIT, reduction_arithmetic_comp, sizeof(reduction_arithmetic_comp), true},
+    {"Shuffle", VK_SUBGROUP_FEATURE_SHUFFLE_BIT, reduction_shuffle_comp, sizeof(reduction_shuffle_comp), true},
+    {"Shuffle relative", VK_SUBGROUP_FEATURE_SHUFFLE_RELATIVE_BIT, reduction_shuffle_relative_comp, sizeof(reduction_shuffle_relative_comp), true},
+    {"Clustered", VK_SUBGROUP_FEATURE_CLUSTERED_BIT, reduction_clustered_comp, sizeof(reduction_clustered_comp), false}
+};
+
+struct ReductionConstants
+{
+    uint32_t workgroupSize;
+    VkBool32 scan;
+};
+
+struct ReductionResult
+{
+    Timing timing;
+    bool valid = false;
+};
+
+// Storage buffers and timestamp queries shared by all reduction methods
+class ReductionScene
+{
+public:
+    ReductionScene(const DeviceContext& context, uint32_t queueFamilyIndex, uint32_t workgroupSize, uint32_t workgroupCount);
+    uint32_t getElementCount() const noexcept { return workgroupSize * workgroupCount; }
+    ReductionResult run(const ReductionMethod& method, bool scan);
+
+private:
+    double dispatch(VkPipeline pipeline);
+    bool validate(bool scan);
+
+    const DeviceContext& context;
+    const VkQueue queue;
+    const uint32_t workgroupSize;
+    const uint32_t workgroupCount;
+    std::vector<uint32_t> values;
+    Buffer inputBuffer;
+    Buffer outputBuffer;
+    Buffer stagingBuffer;
+    DescriptorSetLayout setLayout;
+    PipelineLayout pipelineLayout;
+    DescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    CommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    QueryPool queryPool;
+    Fence fence;
+};
+
+ReductionScene::ReductionScene(const DeviceContext& context, uint32_t queueFamilyIndex, uint32_t workgroupSize, uint32_t workgroupCount):
+    context(context),
+    queue(context.getQueue(queueFamilyIndex)),
+    workgroupSize(workgroupSize),
+    workgroupCount(workgroupCount),
+    values(getElementCount()),
+    commandPool(context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+    queryPool(context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 2)),
+    fence(context.createFence())
+{
+    const VkDeviceSize size = getElementCount() * sizeof(uint32_t);
+    inputBuffer = context.createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    outputBuffer = context.createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    stagingBuffer = context.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    // Small values so that workgroup sums don't overflow
+    for (uint32_t i = 0; i < getElementCount(); ++i)
+        values[i] = (i * 2654435761u) >> 28;
+    memcpy(stagingBuffer.data, values.data(), static_cast<std::size_t>(size));
+    commandBuffer = context.allocateCommandBuffer(commandPool);
+    beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    const VkBufferCopy region = {0, 0, size};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, inputBuffer, 1, &region);
+    endCommandBuffer(commandBuffer);
+    context.submitAndWait(queue, commandBuffer, fence);
+    std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        bindings[i] = {};
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    setLayout = context.createDescriptorSetLayout(bindings);
+    pipelineLayout = context.createPipelineLayout({setLayout});
+    descriptorPool = context.createDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2}});
+    descriptorSet = context.allocateDescriptorSet(descriptorPool, setLayout);
+    const VkDescriptorBufferInfo bufferInfos[] = {
+        {inputBuffer, 0, VK_WHOLE_SIZE},
+        {outputBuffer, 0, VK_WHOLE_SIZE}
+    };
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorCount = 2;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.pBufferInfo = bufferInfos;
+    vkUpdateDescriptorSets(context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
+ReductionResult ReductionScene::run(const ReductionMethod& method, bool scan)
+{
+    ShaderModule shader = context.createShaderModule(method.code, method.size);
+    const ReductionConstants constants = {workgroupSize, scan ? VK_TRUE : VK_FALSE};
+    const VkSpecializationMapEntry mapEntries[] = {
+        {0, offsetof(ReductionConstants, workgroupSize), sizeof(uint32_t)},
+        {1, offsetof(ReductionConstants, scan), sizeof(VkBool32)}
+    };
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 2;
+    specializationInfo.pMapEntries = mapEntries;
+    specializationInfo.dataSize = sizeof(ReductionConstants);
+    specializationInfo.pData = &constants;
+    Pipeline pipeline = context.createComputePipeline(shader, &specializationInfo, pipelineLayout);
+    dispatch(pipeline); // Warm up
+    ReductionResult result;
+    result.timing = measureSamples(repeatCount,
+        [&]()
+        {
+            return dispatch(pipeline);
+        });
+    result.valid = validate(scan);
+    return result;
+}
+
+// Returns GPU time in milliseconds
+double ReductionScene::dispatch(VkPipeline pipeline)
+{
+    beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    vkCmdDispatch(commandBuffer, workgroupCount, 1, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    endCommandBuffer(commandBuffer);
+    context.submitAndWait(queue, commandBuffer, fence);
+    uint64_t timestamps[2];
+    checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+    return context.timestampDelta(timestamps[0], timestamps[1]);
+}
+
+// Compares output of the last dispatch with reference computed on CPU
+bool ReductionScene::validate(bool scan)
+{
+    beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        1, &barrier, 0, nullptr, 0, nullptr);
+    const VkBufferCopy region = {0, 0, outputBuffer.size};
+    vkCmdCopyBuffer(commandBuffer, outputBuffer, stagingBuffer, 1, &region);
+    endCommandBuffer(commandBuffer);
+    context.submitAndWait(queue, commandBuffer, fence);
+    const uint32_t *results = static_cast<const uint32_t *>(stagingBuffer.data);
+    for (uint32_t group = 0; group < workgroupCount; ++group)
+    {
+        uint32_t sum = 0;
+        for (uint32_t i = group * workgroupSize; i < (group + 1) * workgroupSize; ++i)
+        {
+            sum += values[i];
+            if (scan && (results[i] != sum))
+                return false;
+        }
+        if (!scan && (results[group] != sum))
+            return false;
+    }
+    return true;
+}
+
+static std::string elementRateString(const ReductionResult& result, uint32_t elementCount)
+{
+    if (!result.valid)
+        return "Invalid";
+    return fixedString(elementCount / (result.timing.median * 1e6), 2);
+}
+
+void benchmarkSubgroups(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    VkPhysicalDeviceSubgroupProperties subgroupProperties;
+    if (!getSubgroupProperties(instance->getHandle(), physicalDevice->getHandle(), subgroupProperties))
+        throw BenchmarkSkipped("Vulkan 1.1 not supported");
+    if (!(subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT))
+        throw BenchmarkSkipped("subgroup operations not supported in compute shaders");
+    DeviceContext context(physicalDevice->getHandle());
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_COMPUTE_BIT);
+    if (!context.getQueueFamilies()[queueFamilyIndex].timestampValidBits)
+        throw BenchmarkSkipped("timestamps not supported by compute queue");
+    // Power of two that fits device limits
+    const VkPhysicalDeviceLimits& limits = context.getLimits();
+    const uint32_t workgroupSizeLimit = std::min({maxWorkgroupSize,
+        limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations});
+    uint32_t workgroupSize = 1;
+    while (workgroupSize * 2 <= workgroupSizeLimit)
+        workgroupSize *= 2;
+    if (workgroupSize < subgroupProperties.subgroupSize)
+        throw BenchmarkSkipped("subgroup is wider than workgroup");
+    const uint32_t workgroupCount = std::min(maxElementCount / workgroupSize, limits.maxComputeWorkGroupCount[0]);
+    ReductionScene scene(context, queueFamilyIndex, workgroupSize, workgroupCount);
+    const uint32_t elementCount = scene.getElementCount();
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Subgroup size", subgroupProperties.subgroupSize);
+    printLn("Workgroup size", workgroupSize);
+    printLn("Elements", elementCount);
+    printEndLn();
+    std::cout << "Workgroup reduction and inclusive scan, billion elements/s" << std::endl;
+    printRow({"Method", "Reduce", "Scan", "Reduce speedup", "Scan speedup"}, 18);
+    ReductionResult sharedReduce, sharedScan;
+    for (const ReductionMethod& method : reductionMethods)
+    {
+        if ((subgroupProperties.supportedOperations & method.requiredOperations) != method.requiredOperations)
+        {
+            printRow({method.name, "Not supported"}, 18);
+            continue;
+        }
+        const ReductionResult reduce = scene.run(method, false);
+        ReductionResult scan;
+        if (method.scan)
+            scan = scene.run(method, true);
+        recordResult(std::string(method.name) + "/reduce", reduce.timing);
+        if (method.scan)
+            recordResult(std::string(method.name) + "/scan", scan.timing);
+        if (!method.requiredOperations)
+        {
+            sharedReduce = reduce;
+            sharedScan = scan;
+        }
+        printRow({
+            method.name,
+            elementRateString(reduce, elementCount),
+            method.scan ? elementRateString(scan, elementCount) : "---",
+            fixedString(sharedReduce.timing.median / reduce.timing.median, 2) + "x",
+            method.scan ? fixedString(sharedScan.timing.median / scan.timing.median, 2) + "x" : "---"});
+    }
+}
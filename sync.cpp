@@ -0,0 +1,369 @@
+#include <atomic>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/pipeline.comp.h"
+
+// Tails need many samples, so latencies are sampled fixed number of times
+static const uint32_t latencySampleCount = 1000;
+static const uint32_t hostSignalSampleCount = 200;
+static const uint32_t syncCount = 256;
+static const uint32_t localSize = 64;
+static const uint32_t groupCount = 64;
+static const uint32_t repeatCount = 20;
+
+// Empty batch that only waits for and signals semaphores
+static void submitBatch(VkQueue queue, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence,
+    const void *next = nullptr)
+{
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = next;
+    submitInfo.waitSemaphoreCount = waitSemaphore ? 1 : 0;
+    submitInfo.pWaitSemaphores = &waitSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.signalSemaphoreCount = signalSemaphore ? 1 : 0;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+    checkResult(vkQueueSubmit(queue, 1, &submitInfo, fence), "vkQueueSubmit");
+}
+
+// From submission of empty batch until vkWaitForFences() returns
+static Timing measureFenceRoundTrip(const DeviceContext& context, VkQueue queue, VkFence fence)
+{
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < latencySampleCount; ++i)
+    {
+        const auto begin = Clock::now();
+        submitBatch(queue, VK_NULL_HANDLE, VK_NULL_HANDLE, fence);
+        checkResult(vkWaitForFences(context.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+        samples.push_back(elapsedMilliseconds(begin, Clock::now()));
+        checkResult(vkResetFences(context.getDevice(), 1, &fence), "vkResetFences");
+    }
+    return summarize(std::move(samples));
+}
+
+// Semaphore is signaled by first queue and waited by second one, which signals fence
+static Timing measureHandoff(const DeviceContext& context, VkQueue srcQueue, VkQueue dstQueue,
+    VkSemaphore semaphore, VkFence fence)
+{
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < latencySampleCount; ++i)
+    {
+        const auto begin = Clock::now();
+        submitBatch(srcQueue, VK_NULL_HANDLE, semaphore, VK_NULL_HANDLE);
+        submitBatch(dstQueue, semaphore, VK_NULL_HANDLE, fence);
+        checkResult(vkWaitForFences(context.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+        samples.push_back(elapsedMilliseconds(begin, Clock::now()));
+        checkResult(vkResetFences(context.getDevice(), 1, &fence), "vkResetFences");
+    }
+    return summarize(std::move(samples));
+}
+
+#ifdef VK_KHR_timeline_semaphore
+// Feature is queried through instance created by createInstance(),
+// which enables VK_KHR_get_physical_device_properties2 for Vulkan 1.0.
+static bool timelineSemaphoreSupported(VkInstance instance, VkPhysicalDevice physicalDevice)
+{
+    if (!deviceExtensionSupported(physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+        return false;
+    auto getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(instance, (enumerateInstanceVersion() >= VK_API_VERSION_1_1) ?
+            "vkGetPhysicalDeviceFeatures2" : "vkGetPhysicalDeviceFeatures2KHR"));
+    if (!getPhysicalDeviceFeatures2)
+        return false;
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2KHR features2 = {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features2.pNext = &timelineSemaphoreFeatures;
+    getPhysicalDeviceFeatures2(physicalDevice, &features2);
+    return timelineSemaphoreFeatures.timelineSemaphore != VK_FALSE;
+}
+
+struct TimelineResult
+{
+    Timing roundTrip; // From submission until vkWaitSemaphores() returns
+    Timing hostSignal; // From vkSignalSemaphore() on another thread until vkWaitSemaphores() returns
+};
+
+static TimelineResult measureTimelineSemaphore(const DeviceContext& context, VkQueue queue)
+{
+    auto waitSemaphores = context.getProc<PFN_vkWaitSemaphoresKHR>("vkWaitSemaphores");
+    auto signalSemaphore = context.getProc<PFN_vkSignalSemaphoreKHR>("vkSignalSemaphore");
+    if (!waitSemaphores || !signalSemaphore)
+        throw BenchmarkSkipped("timeline semaphore entry points not found");
+    VkSemaphoreTypeCreateInfoKHR semaphoreTypeInfo = {};
+    semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    semaphoreTypeInfo.initialValue = 0;
+    Semaphore semaphore = context.createSemaphore(&semaphoreTypeInfo);
+    uint64_t value = 0;
+    VkSemaphoreWaitInfoKHR waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = semaphore.address();
+    waitInfo.pValues = &value;
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &value;
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < latencySampleCount; ++i)
+    {
+        ++value;
+        const auto begin = Clock::now();
+        submitBatch(queue, VK_NULL_HANDLE, semaphore, VK_NULL_HANDLE, &timelineInfo);
+        checkResult(waitSemaphores(context.getDevice(), &waitInfo, UINT64_MAX), "vkWaitSemaphores");
+        samples.push_back(elapsedMilliseconds(begin, Clock::now()));
+    }
+    TimelineResult result;
+    result.roundTrip = summarize(std::move(samples));
+    samples.clear();
+    for (uint32_t i = 0; i < hostSignalSampleCount; ++i)
+    {
+        ++value;
+        std::atomic<Clock::rep> signalTime(0);
+        VkResult signalResult = VK_SUCCESS;
+        std::thread signaler(
+            [&]()
+            {   // Signal from another CPU than pinned waiter, after it blocks
+                unpinThread();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                VkSemaphoreSignalInfoKHR signalInfo = {};
+                signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO_KHR;
+                signalInfo.semaphore = semaphore;
+                signalInfo.value = value;
+                signalTime = Clock::now().time_since_epoch().count();
+                signalResult = signalSemaphore(context.getDevice(), &signalInfo);
+            });
+        const VkResult waitResult = waitSemaphores(context.getDevice(), &waitInfo, UINT64_MAX);
+        const auto end = Clock::now();
+        signaler.join();
+        checkResult(signalResult, "vkSignalSemaphore");
+        checkResult(waitResult, "vkWaitSemaphores");
+        samples.push_back(elapsedMilliseconds(Clock::time_point(Clock::duration(signalTime.load())), end));
+    }
+    result.hostSignal = summarize(std::move(samples));
+    return result;
+}
+#endif // VK_KHR_timeline_semaphore
+
+enum class SyncMethod
+{
+    None,
+    PipelineBarrier,
+    SplitEvent
+};
+
+static const char *syncMethodName(SyncMethod method)
+{
+    switch (method)
+    {
+    case SyncMethod::None: return "None";
+    case SyncMethod::PipelineBarrier: return "Pipeline barrier";
+    case SyncMethod::SplitEvent: return "Event";
+    }
+    return "";
+}
+
+// Dispatch A writes buffer that dispatch C reads, independent dispatch B is in between.
+// Barrier after B makes C wait for both, event set after A lets B overlap with the wait.
+class DependencyScene
+{
+public:
+    DependencyScene(const DeviceContext& context, uint32_t queueFamilyIndex);
+    Timing run(SyncMethod method);
+
+private:
+    double submit();
+
+    const DeviceContext& context;
+    const VkQueue queue;
+    ShaderModule shader;
+    DescriptorSetLayout setLayout;
+    PipelineLayout pipelineLayout;
+    Pipeline pipeline;
+    Buffer buffers[2];
+    DescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSets[2];
+    std::vector<Event> events;
+    CommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    QueryPool queryPool;
+    Fence fence;
+};
+
+DependencyScene::DependencyScene(const DeviceContext& context, uint32_t queueFamilyIndex):
+    context(context),
+    queue(context.getQueue(queueFamilyIndex)),
+    shader(context.createShaderModule(pipeline_comp, sizeof(pipeline_comp))),
+    commandPool(context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+    queryPool(context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 2)),
+    fence(context.createFence())
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    setLayout = context.createDescriptorSetLayout({binding});
+    pipelineLayout = context.createPipelineLayout({setLayout});
+    const uint32_t constants[] = {localSize, 16};
+    const VkSpecializationMapEntry mapEntries[] = {
+        {0, 0, sizeof(uint32_t)},
+        {1, sizeof(uint32_t), sizeof(int32_t)}
+    };
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 2;
+    specializationInfo.pMapEntries = mapEntries;
+    specializationInfo.dataSize = sizeof(constants);
+    specializationInfo.pData = constants;
+    pipeline = context.createComputePipeline(shader, &specializationInfo, pipelineLayout);
+    descriptorPool = context.createDescriptorPool(2, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2}});
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        buffers[i] = context.createBuffer(localSize * groupCount * sizeof(float) * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        descriptorSets[i] = context.allocateDescriptorSet(descriptorPool, setLayout);
+        const VkDescriptorBufferInfo bufferInfo = {buffers[i], 0, VK_WHOLE_SIZE};
+        VkWriteDescriptorSet descriptorWrite = {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[i];
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrite.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+    }
+    for (uint32_t i = 0; i < syncCount; ++i)
+        events.push_back(context.createEvent());
+    commandBuffer = context.allocateCommandBuffer(commandPool);
+}
+
+// Returns GPU time per dependency in milliseconds
+Timing DependencyScene::run(SyncMethod method)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    const VkPipelineStageFlags stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    auto dispatch = [this](uint32_t bufferIndex)
+    {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[bufferIndex], 0, nullptr);
+        vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+    };
+    beginCommandBuffer(commandBuffer);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    for (uint32_t i = 0; i < syncCount; ++i)
+    {
+        dispatch(0);
+        if (SyncMethod::SplitEvent == method)
+            vkCmdSetEvent(commandBuffer, events[i], stage);
+        dispatch(1);
+        if (SyncMethod::PipelineBarrier == method)
+            vkCmdPipelineBarrier(commandBuffer, stage, stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        else if (SyncMethod::SplitEvent == method)
+            vkCmdWaitEvents(commandBuffer, 1, events[i].address(), stage, stage, 1, &barrier, 0, nullptr, 0, nullptr);
+        dispatch(0);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    endCommandBuffer(commandBuffer);
+    return measureSamples(repeatCount,
+        [this]()
+        {   // Events are signaled by previous submission
+            for (const auto& event : events)
+                checkResult(vkResetEvent(context.getDevice(), event), "vkResetEvent");
+            return submit() / syncCount;
+        });
+}
+
+// Returns GPU time between two timestamps in milliseconds
+double DependencyScene::submit()
+{
+    context.submitAndWait(queue, commandBuffer, fence);
+    uint64_t timestamps[2];
+    checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+    return context.timestampDelta(timestamps[0], timestamps[1]);
+}
+
+static void printLatency(const std::string& metric, const std::string& name, const Timing& timing)
+{
+    recordResult(metric + "/" + name, timing);
+    printRow({name, fixedString(timing.median * 1e3, 1), fixedString(timing.p99 * 1e3, 1)}, 30);
+}
+
+void benchmarkSynchronization(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    DeviceOptions options;
+    bool timelineSemaphore = false;
+#ifdef VK_KHR_timeline_semaphore
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+    if (timelineSemaphoreSupported(instance->getHandle(), physicalDevice->getHandle()))
+    {
+        timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+        timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+        options.extendedFeatures = &timelineSemaphoreFeatures;
+        options.extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        timelineSemaphore = true;
+    }
+#else
+    MAGMA_UNUSED(instance);
+#endif // VK_KHR_timeline_semaphore
+    DeviceContext context(physicalDevice->getHandle(), options);
+    uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+    if (UINT32_MAX == queueFamilyIndex)
+        queueFamilyIndex = context.findQueueFamily(VK_QUEUE_COMPUTE_BIT);
+    if (UINT32_MAX == queueFamilyIndex)
+        throw BenchmarkSkipped("no compute queue family");
+    const std::vector<VkQueueFamilyProperties>& queueFamilies = context.getQueueFamilies();
+    const VkQueue queue = context.getQueue(queueFamilyIndex);
+    Fence fence = context.createFence();
+    setFieldWidth(30);
+    printEndLn();
+    std::cout << "#" << queueFamilyIndex << " " << queueFlagsString(queueFamilies[queueFamilyIndex].queueFlags) << std::endl;
+    printLn("Timeline semaphore", booleanString(timelineSemaphore));
+    printEndLn();
+    printRow({"CPU wait latency", "p50, us", "p99, us"}, 30);
+    const std::string metric = "queue family=" + std::to_string(queueFamilyIndex);
+    printLatency(metric, "Fence", measureFenceRoundTrip(context, queue, fence));
+#ifdef VK_KHR_timeline_semaphore
+    if (timelineSemaphore)
+    {
+        const TimelineResult result = measureTimelineSemaphore(context, queue);
+        printLatency(metric, "Timeline semaphore", result.roundTrip);
+        printLatency(metric, "Timeline host signal", result.hostSignal);
+    }
+    else
+#endif // VK_KHR_timeline_semaphore
+        printRow({"Timeline semaphore", "Not supported"}, 30);
+    printEndLn();
+    printRow({"Semaphore handoff", "p50, us", "p99, us"}, 30);
+    Semaphore semaphore = context.createSemaphore();
+    bool handoff = false;
+    for (uint32_t dstFamilyIndex = 0; dstFamilyIndex < queueFamilies.size(); ++dstFamilyIndex)
+    {
+        const VkQueueFlags queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+        if (dstFamilyIndex == queueFamilyIndex || !(queueFamilies[dstFamilyIndex].queueFlags & queueFlags))
+            continue;
+        const VkQueue dstQueue = context.getQueue(dstFamilyIndex);
+        // Difference with fence round trip on destination queue is the cost of handoff
+        const std::string dstMetric = "queue family=" + std::to_string(dstFamilyIndex);
+        printLatency(dstMetric, "Fence #" + std::to_string(dstFamilyIndex), measureFenceRoundTrip(context, dstQueue, fence));
+        printLatency(dstMetric, "#" + std::to_string(queueFamilyIndex) + " -> #" + std::to_string(dstFamilyIndex),
+            measureHandoff(context, queue, dstQueue, semaphore, fence));
+        handoff = true;
+    }
+    if (!handoff)
+        printRow({"No other queue family"}, 30);
+    if (!queueFamilies[queueFamilyIndex].timestampValidBits)
+        return;
+    DependencyScene scene(context, queueFamilyIndex);
+    printEndLn();
+    printRow({"Dependency (GPU)", "p50, us", "p99, us"}, 30);
+    for (SyncMethod method : {SyncMethod::None, SyncMethod::PipelineBarrier, SyncMethod::SplitEvent})
+        printLatency(metric + "/dependency", syncMethodName(method), scene.run(method));
+}
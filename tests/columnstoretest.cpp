@@ -0,0 +1,217 @@
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include "test.h"
+#include "../gpucaps.h"
+#include "../columnstore.h"
+
+// Redirects std::cout to string, so snapshot is formatted by the same printLn() as gpucaps
+class CaptureOutput
+{
+public:
+    CaptureOutput(): buffer(std::cout.rdbuf(stream.rdbuf())) {}
+    ~CaptureOutput() { std::cout.rdbuf(buffer); }
+    std::string str() const { return stream.str(); }
+
+private:
+    std::ostringstream stream;
+    std::streambuf *buffer;
+};
+
+static std::string deviceSnapshot(const char *deviceName)
+{
+    CaptureOutput output;
+    printHeading((std::string(deviceName) + " (0)").c_str());
+    setFieldWidth(20);
+    printEndLn();
+    printLn("API version", "1.2.131");
+    printLn("Device type", "Discrete GPU");
+    printHeading("Device Features");
+    setFieldWidth(45);
+    printEndLn();
+    printLn("Robust buffer access", booleanString(true));
+    printLn("Shader uniform buffer array dynamic indexing", booleanString(true));
+    printLn("Shader storage buffer array dynamic indexing", booleanString(false));
+    printHeading("Device Limits");
+    setFieldWidth(55);
+    printEndLn();
+    printLn("Max compute shared memory size", 49152);
+    printHeading("Queue Family");
+    setFieldWidth(40);
+    std::cout << std::endl << "#0" << std::endl << std::endl;
+    std::cout << "Queue flags";
+    for (const char *bit : {"VK_QUEUE_GRAPHICS_BIT", "VK_QUEUE_COMPUTE_BIT"})
+    {
+        printEndLn();
+        std::cout << '\t' << bit;
+    }
+    printEndLn();
+    printLn("Queue count", 16);
+    printHeading("Inline Uniform Block");
+    setFieldWidth(65);
+    printEndLn();
+    printLn("Inline uniform block", booleanString(true));
+    printLn("Max per stage descriptor update after bind inline uniform blocks", 4);
+    printHeading("Device Extensions");
+    setFieldWidth(45);
+    printEndLn();
+    printLn("Name", "Specification");
+    printLn("VK_KHR_swapchain", 70);
+    return output.str();
+}
+
+static ColumnStore ingestSnapshot(const std::string& snapshot)
+{
+    ColumnStore store;
+    std::istringstream stream(snapshot);
+    store.ingest(stream);
+    return store;
+}
+
+TEST(ingestKeysOneShorterThanFieldWidth)
+{
+    const ColumnStore store = ingestSnapshot(deviceSnapshot("Radeon RX 6800"));
+    CHECK(1 == store.getRowCount());
+    const ColumnStore::Column *uniform = store.findColumn("Device Features/Shader uniform buffer array dynamic indexing");
+    CHECK(uniform && ColumnStore::Type::Boolean == uniform->type);
+    const ColumnStore::Column *storage = store.findColumn("shaderStorageBufferArrayDynamicIndexing");
+    CHECK(storage && ColumnStore::Type::Boolean == storage->type);
+    const ColumnStore::Column *inlineBlocks = store.findColumn("maxPerStageDescriptorUpdateAfterBindInlineUniformBlocks");
+    CHECK(inlineBlocks && ColumnStore::Type::Number == inlineBlocks->type);
+    CHECK(1 == countRows(filter(store, "shaderUniformBufferArrayDynamicIndexing and !shaderStorageBufferArrayDynamicIndexing")));
+    CHECK(1 == countRows(filter(store, "maxPerStageDescriptorUpdateAfterBindInlineUniformBlocks == 4")));
+}
+
+TEST(ingestDeviceSections)
+{
+    const ColumnStore store = ingestSnapshot(deviceSnapshot("Radeon RX 6800"));
+    const ColumnStore::Column *name = store.findColumn("Device/Name");
+    CHECK(name && ColumnStore::Type::String == name->type);
+    const ColumnStore::Column *deviceType = store.findColumn("Device type");
+    CHECK(deviceType && "Discrete GPU" == deviceType->dictionary.at(deviceType->codes.at(0)));
+    CHECK(store.findColumn("Queue Family/#0/Queue flags/VK_QUEUE_COMPUTE_BIT"));
+    CHECK(store.findColumn("Queue Family/#0/Queue count"));
+    CHECK(store.findColumn("Device Extensions/VK_KHR_swapchain"));
+    CHECK(!store.findColumn("Device Extensions/Name"));
+}
+
+// Sample count limits were printed as bitmask before they were decoded
+static std::string limitsSnapshot(const char *deviceName, uint32_t sharedMemorySize, const std::string& sampleCounts)
+{
+    CaptureOutput output;
+    printHeading((std::string(deviceName) + " (0)").c_str());
+    setFieldWidth(20);
+    printEndLn();
+    printLn("API version", "1.2.131");
+    printHeading("Device Limits");
+    setFieldWidth(55);
+    printEndLn();
+    printLn("Max compute shared memory size", sharedMemorySize);
+    printLn("Framebuffer color sample counts", sampleCounts);
+    return output.str();
+}
+
+static std::string groupValue(const std::vector<Group>& groups, uint64_t count)
+{
+    for (const auto& group : groups)
+    {
+        if (group.count == count)
+            return group.value;
+    }
+    return std::string();
+}
+
+TEST(ingestMultipleDevices)
+{
+    ColumnStore store;
+    std::istringstream snapshot(deviceSnapshot("Radeon RX 6800") + deviceSnapshot("GeForce RTX 3080"));
+    CHECK(2 == store.ingest(snapshot));
+    CHECK(2 == store.getRowCount());
+    CHECK(2 == countRows(filter(store, "VK_KHR_swapchain")));
+    CHECK(0 == countRows(filter(store, "VK_KHR_ray_query")));
+    CHECK(2 == countRows(filter(store, "!VK_KHR_ray_query")));
+}
+
+TEST(mixedValueTypesWidenColumnToString)
+{
+    ColumnStore store;
+    std::istringstream snapshot(
+        limitsSnapshot("Radeon RX 580", 32768, "15") +
+        limitsSnapshot("Radeon RX 6800", 65536, "1, 2, 4, 8") +
+        limitsSnapshot("GeForce RTX 3080", 49152, "1, 2, 4, 8"));
+    CHECK(3 == store.ingest(snapshot));
+    const ColumnStore::Column *sampleCounts = store.findColumn("framebufferColorSampleCounts");
+    CHECK(sampleCounts && ColumnStore::Type::String == sampleCounts->type);
+    CHECK(1 == countRows(filter(store, "framebufferColorSampleCounts == 15")));
+    CHECK(2 == countRows(filter(store, "framebufferColorSampleCounts == 1, 2, 4, 8")));
+    const std::vector<Group> groups = groupBy(store, filter(store, ""), "framebufferColorSampleCounts");
+    CHECK(2 == groups.size());
+    CHECK("1, 2, 4, 8" == groupValue(groups, 2));
+    CHECK("15" == groupValue(groups, 1));
+}
+
+TEST(filterNumbersWithSuffix)
+{
+    ColumnStore store;
+    std::istringstream snapshot(
+        limitsSnapshot("Radeon RX 580", 32768, "15") +
+        limitsSnapshot("Radeon RX 6800", 65536, "15") +
+        limitsSnapshot("GeForce RTX 3080", 49152, "15"));
+    store.ingest(snapshot);
+    CHECK(2 == countRows(filter(store, "maxComputeSharedMemorySize >= 48K")));
+    CHECK(1 == countRows(filter(store, "maxComputeSharedMemorySize >= 48K and maxComputeSharedMemorySize < 64K")));
+    CHECK(1 == countRows(filter(store, "maxComputeSharedMemorySize == 32768")));
+    const std::vector<Group> groups = groupBy(store, filter(store, "maxComputeSharedMemorySize > 32K"), "Device/Name");
+    CHECK(2 == groups.size());
+    bool threwUnknown = false;
+    try { filter(store, "maxNothing > 1"); }
+    catch (const std::invalid_argument&) { threwUnknown = true; }
+    CHECK(threwUnknown);
+}
+
+TEST(groupByCountsAbsentValues)
+{
+    ColumnStore store;
+    std::istringstream snapshot(deviceSnapshot("Radeon RX 6800") + limitsSnapshot("Radeon RX 580", 32768, "15"));
+    store.ingest(snapshot);
+    const std::vector<Group> groups = groupBy(store, filter(store, ""), "robustBufferAccess");
+    CHECK(3 == groups.size());
+    for (const auto& group : groups)
+        CHECK(group.count == (("No" == group.value) ? 0 : 1));
+}
+
+TEST(saveLoadRoundTrip)
+{
+    TemporaryFile file("store.gcix");
+    ColumnStore store;
+    std::istringstream snapshot(
+        deviceSnapshot("Radeon RX 6800") +
+        limitsSnapshot("Radeon RX 580", 32768, "15") +
+        limitsSnapshot("GeForce RTX 3080", 49152, "1, 2, 4, 8"));
+    store.ingest(snapshot);
+    store.save(file.name);
+    ColumnStore loaded;
+    loaded.load(file.name);
+    CHECK(loaded.getRowCount() == store.getRowCount());
+    CHECK(loaded.getColumns().size() == store.getColumns().size());
+    for (const char *expression : {"", "shaderUniformBufferArrayDynamicIndexing", "maxComputeSharedMemorySize >= 48K",
+        "framebufferColorSampleCounts == 15", "VK_KHR_swapchain and !VK_KHR_ray_query"})
+    {
+        CHECK(filter(loaded, expression) == filter(store, expression));
+    }
+    const std::vector<Group> groups = groupBy(loaded, filter(loaded, ""), "Device/Name");
+    CHECK(3 == groups.size());
+    CHECK(loaded.findColumn("Device Limits/Framebuffer color sample counts")->dictionary ==
+        store.findColumn("Device Limits/Framebuffer color sample counts")->dictionary);
+}
+
+TEST(loadRejectsOtherFiles)
+{
+    TemporaryFile file("store.gcix");
+    std::ofstream(file.name) << "not an index";
+    ColumnStore store;
+    bool threw = false;
+    try { store.load(file.name); }
+    catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
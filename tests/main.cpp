@@ -0,0 +1,47 @@
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include "test.h"
+
+static uint32_t failureCount = 0;
+
+std::vector<TestCase>& testCases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+void reportFailure(const char *file, int line, const std::string& message)
+{
+    std::cout << file << ":" << line << ": " << message << std::endl;
+    ++failureCount;
+}
+
+// Runs all tests, or those whose name contains the argument
+int main(int argc, char *argv[])
+{
+    uint32_t testCount = 0, failedCount = 0;
+    for (const TestCase& test : testCases())
+    {
+        if (argc > 1 && !strstr(test.name, argv[1]))
+            continue;
+        const uint32_t previousFailureCount = failureCount;
+        try
+        {
+            test.func();
+        }
+        catch (const std::exception& exception)
+        {
+            reportFailure(test.name, 0, std::string("exception: ") + exception.what());
+        }
+        ++testCount;
+        if (failureCount != previousFailureCount)
+        {
+            std::cout << "FAILED " << test.name << std::endl;
+            ++failedCount;
+        }
+    }
+    std::cout << testCount << " tests, " << failedCount << " failed" << std::endl;
+    return failedCount ? 1 : 0;
+}
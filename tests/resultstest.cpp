@@ -0,0 +1,226 @@
+#include <fstream>
+#include "test.h"
+#include "../results.h"
+
+static ResultRecord makeRecord(const std::string& fingerprint, const std::string& metric, double median)
+{
+    ResultRecord record;
+    record.fingerprint = fingerprint;
+    record.time = 1600000000;
+    record.benchmark = "pipelines";
+    record.metric = metric;
+    record.timing = summarize({median * .9, median, median * 1.1});
+    return record;
+}
+
+static uint64_t fileSize(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return file ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+static void appendBytes(const std::string& fileName, const std::string& bytes)
+{
+    std::ofstream file(fileName, std::ios::binary | std::ios::app);
+    file.write(bytes.data(), bytes.size());
+}
+
+static std::size_t countMetric(const std::vector<ResultRecord>& records, const std::string& metric)
+{
+    std::size_t count = 0;
+    for (const auto& record : records)
+        count += (record.metric == metric) ? 1 : 0;
+    return count;
+}
+
+TEST(jsonStringEscapesQuotesAndBackslashes)
+{
+    CHECK(jsonString("a\"b\\c") == "\"a\\\"b\\\\c\"");
+}
+
+TEST(recordRoundTrip)
+{
+    ResultRecord record = makeRecord("1002:73bf:00000001:1:1.2.0.0", "threads=4/\"quoted\" \\ metric", 1.25);
+    record.timing.warmupCount = 3;
+    const std::string line = serializeRecord(record);
+    CHECK(line.find('\n') == std::string::npos);
+    ResultRecord parsed;
+    CHECK(parseRecord(line, parsed));
+    CHECK(parsed.fingerprint == record.fingerprint);
+    CHECK(parsed.time == record.time);
+    CHECK(parsed.benchmark == record.benchmark);
+    CHECK(parsed.metric == record.metric);
+    CHECK(parsed.timing.median == record.timing.median);
+    CHECK(parsed.timing.mean == record.timing.mean);
+    CHECK(parsed.timing.standardDeviation == record.timing.standardDeviation);
+    CHECK(parsed.timing.p99 == record.timing.p99);
+    CHECK(parsed.timing.sampleCount == record.timing.sampleCount);
+    CHECK(3 == parsed.timing.warmupCount);
+}
+
+TEST(parseRecordRejectsIncompleteLine)
+{
+    const std::string line = serializeRecord(makeRecord("fp", "metric", 1.));
+    ResultRecord record;
+    CHECK(!parseRecord(line.substr(0, line.size() / 2), record));
+    CHECK(!parseRecord(line.substr(0, line.size() - 2), record));
+    CHECK(!parseRecord("", record));
+    CHECK(!parseRecord("{\"fingerprint\":\"fp\"}", record));
+}
+
+TEST(storeFindsRecordsByFingerprint)
+{
+    TemporaryFile file("find.jsonl");
+    {
+        ResultStore store(file.name);
+        store.append({makeRecord("a", "x", 1.), makeRecord("b", "x", 2.), makeRecord("a", "y", 3.)});
+        store.append({makeRecord("a", "z", 4.)});
+        CHECK(4 == store.getRecordCount());
+        CHECK(3 == store.find("a").size());
+    }
+    ResultStore store(file.name);
+    CHECK(4 == store.getRecordCount());
+    const std::vector<ResultRecord> records = store.find("b");
+    CHECK(1 == records.size());
+    CHECK(!records.empty() && records[0].timing.median == 2.);
+    CHECK(3 == store.find("a").size());
+    CHECK(store.find("c").empty());
+}
+
+TEST(storeFindsRecordsOfDeviceAcrossDrivers)
+{
+    TemporaryFile file("device.jsonl");
+    ResultStore store(file.name);
+    store.append({makeRecord("1002:73bf:00000001:1:1.2.0.0", "x", 1.), makeRecord("10de:2206:00000001:4:1.2.0.0", "x", 2.)});
+    store.append({makeRecord("1002:73bf:00000002:1:1.2.0.0", "x", 3.)});
+    CHECK(1 == store.find("1002:73bf:00000002:1:1.2.0.0").size());
+    CHECK(2 == store.findDevice("1002:73bf:00000003:1:1.2.0.0").size());
+    CHECK(1 == store.findDevice("10de:2206:00000002:4:1.2.0.0").size());
+    CHECK(store.findDevice("1002:73ff:00000001:1:1.2.0.0").empty());
+}
+
+TEST(storeRebuildsIndexWithOtherKeys)
+{
+    TemporaryFile file("rekey.jsonl");
+    const std::string indexFileName = file.name + ".idx";
+    ResultStore(file.name).append({makeRecord("1002:73bf:00000001:1:1.2.0.0", "x", 1.),
+        makeRecord("1002:73bf:00000002:1:1.2.0.0", "x", 2.)});
+    {   // Index written by previous version was keyed by full fingerprint
+        std::fstream index(indexFileName, std::ios::binary | std::ios::in | std::ios::out);
+        for (std::streamoff offset : {0, 16})
+        {
+            uint64_t key;
+            index.seekg(offset).read(reinterpret_cast<char *>(&key), sizeof(key));
+            key ^= 1;
+            index.seekp(offset).write(reinterpret_cast<const char *>(&key), sizeof(key));
+        }
+    }
+    ResultStore store(file.name);
+    CHECK(2 == store.getRecordCount());
+    CHECK(2 == store.findDevice("1002:73bf:00000001:1:1.2.0.0").size());
+    CHECK(2 * 16 == fileSize(indexFileName));
+}
+
+TEST(storeRebuildsMissingIndex)
+{
+    TemporaryFile file("rebuild.jsonl");
+    ResultStore(file.name).append({makeRecord("a", "x", 1.), makeRecord("a", "y", 2.)});
+    std::remove((file.name + ".idx").c_str());
+    ResultStore store(file.name);
+    CHECK(2 == store.getRecordCount());
+    CHECK(2 == store.find("a").size());
+    CHECK(2 * 16 == fileSize(file.name + ".idx"));
+}
+
+TEST(storeIndexesRecordsAppendedByOthers)
+{
+    TemporaryFile file("behind.jsonl");
+    ResultStore(file.name).append({makeRecord("a", "x", 1.)});
+    appendBytes(file.name, serializeRecord(makeRecord("a", "y", 2.)) + "\n");
+    ResultStore store(file.name);
+    CHECK(2 == store.find("a").size());
+    // Once indexed, reopening doesn't index it again
+    CHECK(2 == ResultStore(file.name).find("a").size());
+    CHECK(2 * 16 == fileSize(file.name + ".idx"));
+}
+
+TEST(storeRecoversFromTornDataWrite)
+{
+    TemporaryFile file("torndata.jsonl");
+    ResultStore(file.name).append({makeRecord("a", "x", 1.)});
+    const std::string line = serializeRecord(makeRecord("a", "torn", 2.));
+    appendBytes(file.name, line.substr(0, line.size() / 2));
+    {
+        ResultStore store(file.name);
+        CHECK(1 == store.getRecordCount());
+        store.append({makeRecord("a", "y", 3.)});
+        const std::vector<ResultRecord> records = store.find("a");
+        CHECK(2 == records.size());
+        CHECK(0 == countMetric(records, "torn"));
+        CHECK(1 == countMetric(records, "y"));
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        const std::vector<ResultRecord> records = ResultStore(file.name).find("a");
+        CHECK(2 == records.size());
+        CHECK(1 == countMetric(records, "x"));
+        CHECK(1 == countMetric(records, "y"));
+    }
+}
+
+TEST(storeRecoversFromTornIndexWrite)
+{
+    TemporaryFile file("tornindex.jsonl");
+    const std::string indexFileName = file.name + ".idx";
+    ResultStore(file.name).append({makeRecord("a", "x", 1.), makeRecord("b", "x", 2.)});
+    CHECK(2 * 16 == fileSize(indexFileName));
+    appendBytes(indexFileName, std::string(3, '\xFF'));
+    {
+        ResultStore store(file.name);
+        // Partial entry is cut off before anything is appended after it
+        CHECK(2 * 16 == fileSize(indexFileName));
+        store.append({makeRecord("a", "y", 3.)});
+        CHECK(3 * 16 == fileSize(indexFileName));
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        ResultStore store(file.name);
+        CHECK(3 == store.getRecordCount());
+        CHECK(2 == store.find("a").size());
+        CHECK(1 == store.find("b").size());
+        CHECK(3 * 16 == fileSize(indexFileName));
+    }
+}
+
+TEST(storeDropsIndexEntriesPastData)
+{
+    TemporaryFile file("truncated.jsonl");
+    const std::string line = serializeRecord(makeRecord("a", "x", 1.)) + "\n";
+    ResultStore(file.name).append({makeRecord("a", "x", 1.), makeRecord("a", "y", 2.)});
+    {   // Data file is truncated to its first record, e.g. restored from backup
+        std::ofstream data(file.name, std::ios::binary | std::ios::trunc);
+        data << line;
+    }
+    ResultStore store(file.name);
+    CHECK(1 == store.getRecordCount());
+    CHECK(16 == fileSize(file.name + ".idx"));
+    store.append({makeRecord("a", "z", 3.)});
+    const std::vector<ResultRecord> records = ResultStore(file.name).find("a");
+    CHECK(2 == records.size());
+    CHECK(1 == countMetric(records, "z"));
+}
+
+TEST(storedBaselineDetectsRegression)
+{
+    TemporaryFile file("baseline.jsonl");
+    ResultStore store(file.name);
+    for (int run = 0; run < 3; ++run)
+        store.append({makeRecord("a", "x", 1. + run * .01)});
+    std::vector<Timing> runs;
+    for (const auto& record : store.find("a"))
+        runs.push_back(record.timing);
+    const Timing baseline = combine(runs);
+    CHECK(9 == baseline.sampleCount);
+    CHECK(significantlySlower(baseline, makeRecord("a", "x", 2.).timing, .05));
+    CHECK(!significantlySlower(baseline, makeRecord("a", "x", 1.01).timing, .05));
+}
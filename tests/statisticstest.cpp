@@ -0,0 +1,273 @@
+#include <random>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "test.h"
+#include "../statistics.h"
+
+// Deterministic noise around <center>, relative amplitude <spread>
+static std::vector<double> noisySamples(std::size_t count, double center, double spread, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> distribution(1. - spread, 1. + spread);
+    std::vector<double> samples;
+    for (std::size_t i = 0; i < count; ++i)
+        samples.push_back(center * distribution(rng));
+    return samples;
+}
+
+TEST(summarizeComputesCentralValuesAndRange)
+{
+    const Timing timing = summarize({5., 1., 4., 2., 3.});
+    CHECK_NEAR(timing.median, 3., 1e-12);
+    CHECK_NEAR(timing.mean, 3., 1e-12);
+    CHECK_NEAR(timing.min, 1., 1e-12);
+    CHECK_NEAR(timing.max, 5., 1e-12);
+    CHECK_NEAR(timing.p99, 5., 1e-12);
+    CHECK_NEAR(timing.mad, 1., 1e-12);
+    CHECK_NEAR(timing.standardDeviation, std::sqrt(2.5), 1e-12);
+    CHECK(timing.confidence > 0.);
+    CHECK(5 == timing.sampleCount);
+    CHECK(0 == timing.outlierCount);
+}
+
+TEST(summarizeOfEmptySamplesIsZero)
+{
+    const Timing timing = summarize({});
+    CHECK(0 == timing.sampleCount);
+    CHECK(0. == timing.median);
+}
+
+TEST(summarizeRejectsOutliersByMad)
+{
+    const Timing timing = summarize({10., 10.1, 9.9, 10.2, 9.8, 10., 100.});
+    CHECK(1 == timing.outlierCount);
+    CHECK(6 == timing.sampleCount);
+    CHECK_NEAR(timing.median, 10., 1e-12);
+    CHECK(timing.mean < 10.1);
+    // Range and tail still include outlier
+    CHECK_NEAR(timing.max, 100., 1e-12);
+    CHECK_NEAR(timing.p99, 100., 1e-12);
+}
+
+TEST(summarizeKeepsAllIfMostSamplesAreEqual)
+{   // MAD is zero, so z-score is undefined
+    const Timing timing = summarize({1., 1., 1., 1., 5.});
+    CHECK(0 == timing.outlierCount);
+    CHECK(5 == timing.sampleCount);
+    CHECK_NEAR(timing.mean, 1.8, 1e-12);
+}
+
+TEST(summarizeP99IsNearestRank)
+{
+    std::vector<double> samples;
+    for (int i = 1; i <= 200; ++i)
+        samples.push_back(i);
+    const Timing timing = summarize(samples);
+    CHECK_NEAR(timing.p99, 198., 1e-12);
+}
+
+TEST(detectWarmupFindsSlowLeadingSamples)
+{
+    CHECK(2 == detectWarmup({5., 3., 1., 1., 1., 1., 1., 1.}, .1, 10));
+    CHECK(0 == detectWarmup({1., 1., 1., 1., 1., 1.}, .1, 10));
+    // Within tolerance of steady state
+    CHECK(0 == detectWarmup({1.05, 1., 1., 1., 1., 1.}, .1, 10));
+}
+
+TEST(detectWarmupIsLimited)
+{   // Too few samples to tell steady state
+    CHECK(0 == detectWarmup({5., 1., 1.}, .1, 10));
+    CHECK(1 == detectWarmup({5., 5., 5., 1., 1., 1., 1., 1.}, .1, 1));
+    // At most half of samples
+    CHECK(3 == detectWarmup({5., 5., 5., 5., 1., 1.}, .1, 10));
+}
+
+TEST(measureFixedTakesExactCountAndDropsWarmup)
+{
+    uint32_t callCount = 0;
+    const Timing timing = measureFixed(20,
+        [&]() { return (callCount++ < 3) ? 10. : 1.; });
+    CHECK(20 == callCount);
+    CHECK(3 == timing.warmupCount);
+    CHECK(17 == timing.sampleCount);
+    CHECK_NEAR(timing.median, 1., 1e-12);
+}
+
+TEST(measureSamplesIsFixedByDefault)
+{
+    CHECK(!measurementPolicy.adaptive);
+    uint32_t callCount = 0;
+    const std::vector<double> samples = noisySamples(1000, 1., .5, 1);
+    measureSamples(10, [&]() { return samples[callCount++]; });
+    CHECK(10 == callCount);
+}
+
+TEST(measureAdaptiveStopsWhenConfident)
+{
+    MeasurementPolicy policy;
+    uint32_t callCount = 0;
+    const Timing timing = measureAdaptive(10, [&]() { ++callCount; return 2.; }, policy);
+    CHECK(10 == callCount);
+    CHECK(10 == timing.sampleCount);
+    CHECK_NEAR(timing.median, 2., 1e-12);
+}
+
+TEST(measureAdaptiveContinuesUntilConfident)
+{
+    MeasurementPolicy policy;
+    policy.targetConfidence = .01;
+    const std::vector<double> samples = noisySamples(policy.maxSampleCount, 1., .2, 2);
+    uint32_t callCount = 0;
+    const Timing timing = measureAdaptive(10, [&]() { return samples[callCount++]; }, policy);
+    CHECK(callCount > 10);
+    CHECK(callCount < policy.maxSampleCount);
+    CHECK(timing.relativeConfidence() <= policy.targetConfidence);
+}
+
+TEST(measureAdaptiveStopsAtSampleLimit)
+{
+    MeasurementPolicy policy;
+    policy.targetConfidence = 0.;
+    policy.maxSampleCount = 50;
+    const std::vector<double> samples = noisySamples(policy.maxSampleCount, 1., .5, 3);
+    uint32_t callCount = 0;
+    measureAdaptive(10, [&]() { return samples[callCount++]; }, policy);
+    CHECK(50 == callCount);
+}
+
+TEST(measureAdaptiveStopsAtTimeBudget)
+{
+    MeasurementPolicy policy;
+    policy.targetConfidence = 0.;
+    policy.timeBudget = 0.;
+    const std::vector<double> samples = noisySamples(policy.maxSampleCount, 1., .5, 4);
+    uint32_t callCount = 0;
+    const Timing timing = measureAdaptive(10, [&]() { return samples[callCount++]; }, policy);
+    // Minimum steady count is still taken
+    CHECK(callCount >= 10);
+    CHECK(callCount < 10 + policy.maxWarmupCount + 1);
+    CHECK(timing.sampleCount + timing.outlierCount >= 10);
+}
+
+TEST(measureAdaptiveSkipsWarmup)
+{
+    MeasurementPolicy policy;
+    uint32_t callCount = 0;
+    const Timing timing = measureAdaptive(10, [&]() { return (callCount++ < 4) ? 20. : 2.; }, policy);
+    CHECK(4 == timing.warmupCount);
+    CHECK(10 == timing.sampleCount);
+    CHECK_NEAR(timing.max, 2., 1e-12);
+}
+
+TEST(summarizePairedDropsSameSamples)
+{
+    const std::vector<double> frame = {9., 10., 10.1, 9.9, 10.2, 9.8, 10., 100.};
+    const std::vector<double> part = {1., 2., 2., 2., 2., 2., 2., 50.};
+    const std::vector<Timing> timings = summarizePaired({frame, part}, 1);
+    CHECK(2 == timings.size());
+    CHECK(1 == timings[0].warmupCount && 1 == timings[1].warmupCount);
+    CHECK(1 == timings[0].outlierCount && 1 == timings[1].outlierCount);
+    CHECK(6 == timings[1].sampleCount);
+    // Second series is summarized over samples kept in the first one
+    CHECK_NEAR(timings[1].mean, 2., 1e-12);
+    CHECK_NEAR(timings[1].max, 50., 1e-12);
+}
+
+TEST(summarizePairedOfSingleSeriesMatchesSummarize)
+{
+    const std::vector<double> samples = noisySamples(100, 5., .1, 5);
+    const Timing paired = summarizePaired({samples}, 0).front();
+    const Timing single = summarize(samples);
+    CHECK_NEAR(paired.median, single.median, 1e-12);
+    CHECK_NEAR(paired.mean, single.mean, 1e-12);
+    CHECK_NEAR(paired.p99, single.p99, 1e-12);
+    CHECK(paired.sampleCount == single.sampleCount);
+}
+
+TEST(measurePairedReturnsTimingPerValue)
+{
+    uint32_t callCount = 0;
+    const std::vector<Timing> timings = measurePaired(20,
+        [&]() { ++callCount; return std::vector<double>{3., 1., 2.}; });
+    CHECK(20 == callCount);
+    CHECK(3 == timings.size());
+    CHECK_NEAR(timings[0].median, 3., 1e-12);
+    CHECK_NEAR(timings[1].median, 1., 1e-12);
+    CHECK_NEAR(timings[2].median, 2., 1e-12);
+}
+
+TEST(combinePoolsRuns)
+{
+    const Timing first = summarize({1., 2., 3.});
+    const Timing second = summarize({3., 4., 5.});
+    const Timing pooled = combine({first, second});
+    CHECK(6 == pooled.sampleCount);
+    CHECK_NEAR(pooled.mean, 3., 1e-12);
+    CHECK_NEAR(pooled.median, 3., 1e-12);
+    CHECK_NEAR(pooled.min, 1., 1e-12);
+    CHECK_NEAR(pooled.max, 5., 1e-12);
+    // Same as standard deviation of all six samples
+    CHECK_NEAR(pooled.standardDeviation, std::sqrt(2.), 1e-12);
+}
+
+TEST(combineIgnoresEmptyRuns)
+{
+    const Timing pooled = combine({Timing(), summarize({2., 2.})});
+    CHECK(2 == pooled.sampleCount);
+    CHECK_NEAR(pooled.min, 2., 1e-12);
+    CHECK(0 == combine({}).sampleCount);
+}
+
+TEST(significantlySlowerDetectsRegression)
+{
+    const Timing baseline = summarize(noisySamples(50, 1., .05, 6));
+    const Timing slower = summarize(noisySamples(50, 1.2, .05, 7));
+    const Timing same = summarize(noisySamples(50, 1., .05, 8));
+    CHECK(significantlySlower(baseline, slower, .05));
+    CHECK(!significantlySlower(slower, baseline, .05));
+    CHECK(!significantlySlower(baseline, same, .05));
+    // Significant, but smaller than minimal relative change
+    CHECK(!significantlySlower(baseline, slower, .5));
+}
+
+TEST(significantlySlowerNeedsSamples)
+{
+    const Timing single = summarize({1.});
+    const Timing slower = summarize({2., 2.1, 1.9});
+    CHECK(!significantlySlower(single, slower, .05));
+    // Exact measurements that differ
+    CHECK(significantlySlower(summarize({1., 1.}), summarize({2., 2.}), .05));
+}
+
+#ifdef __linux__
+static int threadCpuCount()
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet);
+    return CPU_COUNT(&cpuSet);
+}
+
+TEST(threadOfPinnedThreadCanUnpin)
+{   // Pinned in its own thread, so that other tests aren't affected
+    std::thread([]()
+    {
+        const int cpuCount = threadCpuCount();
+        cpu_set_t cpuSet;
+        sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet);
+        int cpuIndex = 0;
+        while (!CPU_ISSET(cpuIndex, &cpuSet))
+            ++cpuIndex;
+        CHECK(pinThreadToCpu(static_cast<uint32_t>(cpuIndex)));
+        CHECK(1 == threadCpuCount());
+        std::thread([cpuCount]()
+        {
+            CHECK(1 == threadCpuCount());
+            CHECK(unpinThread());
+            CHECK(cpuCount == threadCpuCount());
+        }).join();
+    }).join();
+}
+#endif // __linux__
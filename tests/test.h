@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+
+// Minimal test registry: TEST(name) defines function that tests/main.cpp runs,
+// failed checks are reported and counted, but don't stop the test
+
+struct TestCase
+{
+    const char *name;
+    void (*func)();
+};
+
+std::vector<TestCase>& testCases();
+void reportFailure(const char *file, int line, const std::string& message);
+
+struct TestRegistrar
+{
+    TestRegistrar(const char *name, void (*func)()) { testCases().push_back({name, func}); }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) reportFailure(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+    do { if (std::fabs((value) - (expected)) > (tolerance)) \
+        reportFailure(__FILE__, __LINE__, #value " is " + std::to_string(value) + ", expected " + std::to_string(expected)); } while (0)
+
+// File in working directory that is removed, along with its index, before and after test
+struct TemporaryFile
+{
+    explicit TemporaryFile(const std::string& name): name("gpucaps-test-" + name) { remove(); }
+    ~TemporaryFile() { remove(); }
+    void remove() const
+    {
+        std::remove(name.c_str());
+        std::remove((name + ".idx").c_str());
+    }
+
+    const std::string name;
+};
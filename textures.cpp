@@ -0,0 +1,264 @@
+#include <random>
+#include <cstring>
+#include "gpucaps.h"
+#include "benchmark.h"
+#include "shaders/texture.comp.h"
+
+static const uint32_t textureSize = 4096;
+static const int32_t tapCount = 16;
+static const uint32_t repeatCount = 10;
+
+struct TextureFormat
+{
+    const char *name;
+    VkFormat format;
+    uint32_t blockSize; // Block width and height in texels
+    uint32_t blockBytes;
+    VkBool32 VkPhysicalDeviceFeatures::*feature; // Null for uncompressed
+};
+
+static const TextureFormat textureFormats[] = {
+    {"RGBA8", VK_FORMAT_R8G8B8A8_UNORM, 1, 4, nullptr},
+    {"BC1", VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4, 8, &VkPhysicalDeviceFeatures::textureCompressionBC},
+    {"BC7", VK_FORMAT_BC7_UNORM_BLOCK, 4, 16, &VkPhysicalDeviceFeatures::textureCompressionBC},
+    {"ETC2", VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, 4, 8, &VkPhysicalDeviceFeatures::textureCompressionETC2},
+    {"ASTC 4x4", VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 4, 16, &VkPhysicalDeviceFeatures::textureCompressionASTC_LDR}
+};
+
+static VkDeviceSize textureDataSize(const TextureFormat& textureFormat) noexcept
+{
+    const VkDeviceSize blockCount = textureSize / textureFormat.blockSize;
+    return blockCount * blockCount * textureFormat.blockBytes;
+}
+
+// Random blocks that are legal encodings of every format. Any bit pattern is legal for BC1
+// and ETC2, but random BC7 blocks are mostly mode 0 and random ASTC blocks are mostly
+// illegal and decode to error color, so their headers are fixed up.
+static void fillBlocks(const TextureFormat& textureFormat, void *data)
+{
+    std::mt19937 rng(0);
+    uint32_t *words = static_cast<uint32_t *>(data);
+    const VkDeviceSize wordCount = textureDataSize(textureFormat) / sizeof(uint32_t);
+    for (VkDeviceSize i = 0; i < wordCount; ++i)
+        words[i] = rng();
+    const uint32_t blockWords = textureFormat.blockBytes / sizeof(uint32_t);
+    for (VkDeviceSize i = 0; i < wordCount; i += blockWords)
+    {
+        uint32_t& header = words[i];
+        switch (textureFormat.format)
+        {
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            {   // Mode is index of the lowest set bit, modes 0-7 are used evenly
+                const uint32_t mode = static_cast<uint32_t>(i / blockWords % 8);
+                header = (header & ~((2u << mode) - 1)) | (1u << mode);
+            }
+            break;
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+            // Block mode 0x242: 4x4 weights of 16 levels, single plane; single partition of
+            // LDR RGB direct endpoints (CEM 8). Remaining endpoint and weight bits are arbitrary.
+            header = (header & ~0x1FFFFu) | 0x242u | (8u << 13);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+struct TextureResult
+{
+    Timing upload;
+    Timing sample;
+};
+
+// Uploads texture from staging buffer and samples it with bilinear filter in compute shader
+class TextureScene
+{
+public:
+    TextureScene(const DeviceContext& context, uint32_t queueFamilyIndex);
+    TextureResult run(const TextureFormat& textureFormat);
+
+private:
+    double submit();
+
+    const DeviceContext& context;
+    const VkQueue queue;
+    Buffer stagingBuffer;
+    Buffer resultBuffer;
+    Sampler sampler;
+    ShaderModule shader;
+    DescriptorSetLayout setLayout;
+    PipelineLayout pipelineLayout;
+    Pipeline pipeline;
+    DescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    CommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    QueryPool queryPool;
+    Fence fence;
+};
+
+TextureScene::TextureScene(const DeviceContext& context, uint32_t queueFamilyIndex):
+    context(context),
+    queue(context.getQueue(queueFamilyIndex)),
+    sampler(context.createSampler(VK_FILTER_LINEAR)),
+    shader(context.createShaderModule(texture_comp, sizeof(texture_comp))),
+    commandPool(context.createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+    queryPool(context.createQueryPool(VK_QUERY_TYPE_TIMESTAMP, 2)),
+    fence(context.createFence())
+{
+    VkDeviceSize maxDataSize = 0;
+    for (const auto& textureFormat : textureFormats)
+        maxDataSize = std::max(maxDataSize, textureDataSize(textureFormat));
+    stagingBuffer = context.createBuffer(maxDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    resultBuffer = context.createBuffer(sizeof(float) * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+    bindings[0] = {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    bindings[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    setLayout = context.createDescriptorSetLayout(bindings);
+    pipelineLayout = context.createPipelineLayout({setLayout});
+    const VkSpecializationMapEntry mapEntry = {0, 0, sizeof(int32_t)};
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &mapEntry;
+    specializationInfo.dataSize = sizeof(int32_t);
+    specializationInfo.pData = &tapCount;
+    pipeline = context.createComputePipeline(shader, &specializationInfo, pipelineLayout);
+    descriptorPool = context.createDescriptorPool(1, {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+    descriptorSet = context.allocateDescriptorSet(descriptorPool, setLayout);
+    commandBuffer = context.allocateCommandBuffer(commandPool);
+}
+
+TextureResult TextureScene::run(const TextureFormat& textureFormat)
+{
+    fillBlocks(textureFormat, stagingBuffer.data);
+    Image texture = context.createImage(textureFormat.format, textureSize, textureSize,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    const VkDescriptorImageInfo imageInfo = {sampler, texture.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    const VkDescriptorBufferInfo bufferInfo = {resultBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet descriptorWrites[2] = {};
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].descriptorCount = 1;
+    }
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[0].pImageInfo = &imageInfo;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context.getDevice(), 2, descriptorWrites, 0, nullptr);
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VkBufferImageCopy region = {};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = texture.extent;
+    TextureResult result;
+    result.upload = measureSamples(repeatCount,
+        [&]()
+        {   // Previous contents are discarded every time
+            beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                0, nullptr, 0, nullptr, 1, &barrier);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                0, nullptr, 0, nullptr, 1, &barrier);
+            endCommandBuffer(commandBuffer);
+            return submit();
+        });
+    result.sample = measureSamples(repeatCount,
+        [&]()
+        {
+            beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+            vkCmdDispatch(commandBuffer, textureSize/8, textureSize/8, 1);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+            endCommandBuffer(commandBuffer);
+            return submit();
+        });
+    return result;
+}
+
+// Returns GPU time between two timestamps in milliseconds
+double TextureScene::submit()
+{
+    context.submitAndWait(queue, commandBuffer, fence);
+    uint64_t timestamps[2];
+    checkResult(vkGetQueryPoolResults(context.getDevice(), queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "vkGetQueryPoolResults");
+    return context.timestampDelta(timestamps[0], timestamps[1]);
+}
+
+static bool formatSupported(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures& features,
+    const TextureFormat& textureFormat)
+{
+    if (textureFormat.feature && !(features.*textureFormat.feature))
+        return false;
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, textureFormat.format, &formatProperties);
+    const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+void benchmarkTextures(magma::InstancePtr instance, magma::PhysicalDevicePtr physicalDevice)
+{
+    MAGMA_UNUSED(instance);
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice->getHandle(), &features);
+    DeviceOptions options;
+    options.features.textureCompressionBC = features.textureCompressionBC;
+    options.features.textureCompressionETC2 = features.textureCompressionETC2;
+    options.features.textureCompressionASTC_LDR = features.textureCompressionASTC_LDR;
+    DeviceContext context(physicalDevice->getHandle(), options);
+    const uint32_t queueFamilyIndex = context.findQueueFamily(VK_QUEUE_COMPUTE_BIT);
+    if (!context.getQueueFamilies()[queueFamilyIndex].timestampValidBits)
+        throw BenchmarkSkipped("timestamps not supported by compute queue");
+    TextureScene scene(context, queueFamilyIndex);
+    const double texelCount = static_cast<double>(textureSize) * textureSize;
+    setFieldWidth(30);
+    printEndLn();
+    printLn("Texture size", textureSize, textureSize);
+    printLn("Bilinear taps per texel", tapCount);
+    printEndLn();
+    printRow({"Format", "Bits per texel", "Upload, GB/s", "Upload, GT/s", "Sample, GT/s"});
+    for (const auto& textureFormat : textureFormats)
+    {
+        if (!formatSupported(context.getPhysicalDevice(), features, textureFormat))
+        {
+            printRow({textureFormat.name, "Not supported"});
+            continue;
+        }
+        const TextureResult result = scene.run(textureFormat);
+        recordResult(std::string(textureFormat.name) + "/upload", result.upload);
+        recordResult(std::string(textureFormat.name) + "/sample", result.sample);
+        const VkDeviceSize dataSize = textureDataSize(textureFormat);
+        printRow({
+            textureFormat.name,
+            std::to_string(textureFormat.blockBytes * 8 / (textureFormat.blockSize * textureFormat.blockSize)),
+            fixedString(gigabytesPerSecond(dataSize, result.upload.median), 2),
+            fixedString(texelCount / (result.upload.median * 1e6), 2),
+            fixedString(texelCount * tapCount / (result.sample.median * 1e6), 2)});
+    }
+}